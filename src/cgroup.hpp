@@ -0,0 +1,119 @@
+#pragma once
+
+#include "config.h"
+#include "util.hpp"
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+
+struct CgroupUsage {
+    double cpuSeconds = 0;
+    unsigned long long peakMemoryBytes = 0;
+};
+
+// Per-task cgroup v2 subtrees for cpu_max/memory_max. Only works when taskr runs in a delegated cgroup
+// (e.g. `systemd-run --user --scope -p Delegate=yes taskr ...`), otherwise the limits are skipped with a warning
+class CgroupManager {
+  public:
+    // Creates a cgroup with the task's limits, returns an empty path when cgroups can't be used
+    fs::path create(const Task &task) {
+        std::lock_guard lock(mutex);
+        if (!initialized) {
+            initialized = true;
+            available = setup();
+        }
+
+        if (!available) {
+            if (!warned) {
+                warned = true;
+                std::cerr << "Taskr: cgroup v2 delegation is not available, ignoring cpu_max and memory_max" << std::endl;
+            }
+            return {};
+        }
+
+        fs::path cgroup = root / ("taskr-" + task.name);
+        std::error_code error;
+        fs::create_directory(cgroup, error);
+        if (error || (!task.cpuMax.empty() && !write_file(cgroup / "cpu.max", task.cpuMax)) ||
+            (!task.memoryMax.empty() && !write_file(cgroup / "memory.max", task.memoryMax))) {
+            std::cerr << "Taskr: could not apply cgroup limits for '" << task.name << "'" << std::endl;
+            fs::remove(cgroup, error);
+            return {};
+        }
+        return cgroup;
+    }
+
+    CgroupUsage usage(const fs::path &cgroup) const {
+        CgroupUsage usage;
+
+        std::ifstream cpuStat(cgroup / "cpu.stat");
+        std::string key;
+        unsigned long long value;
+        while (cpuStat >> key >> value) {
+            if (key == "usage_usec") {
+                usage.cpuSeconds = static_cast<double>(value) / 1e6;
+            }
+        }
+
+        std::ifstream memoryPeak(cgroup / "memory.peak");
+        memoryPeak >> usage.peakMemoryBytes;
+        return usage;
+    }
+
+    void remove(const fs::path &cgroup) const {
+        std::error_code error;
+        fs::remove(cgroup, error);
+    }
+
+  private:
+    std::mutex mutex;
+    bool initialized = false;
+    bool available = false;
+    bool warned = false;
+    fs::path root;
+
+    static bool write_file(const fs::path &path, const std::string &value) {
+        std::ofstream file(path);
+        file << value;
+        file.flush();
+        return file.good();
+    }
+
+    // Moves taskr into a leaf of its own cgroup, so the controllers can be enabled for the task subtrees next to it
+    bool setup() {
+#ifdef __linux__
+        std::ifstream self("/proc/self/cgroup");
+        std::string line;
+        while (std::getline(self, line)) {
+            if (line.rfind("0::", 0) == 0) {
+                root = fs::path("/sys/fs/cgroup") / fs::path(line.substr(3)).relative_path();
+            }
+        }
+
+        std::ifstream controllersFile(root / "cgroup.controllers");
+        std::string controller;
+        std::string enable;
+        while (controllersFile >> controller) {
+            if (controller == "cpu" || controller == "memory") {
+                enable += "+" + controller + " ";
+            }
+        }
+
+        if (root.empty() || enable.empty() || access(root.c_str(), W_OK) != 0) {
+            return false;
+        }
+
+        std::error_code error;
+        fs::create_directory(root / "taskr", error);
+        if (error || !write_file(root / "taskr" / "cgroup.procs", std::to_string(getpid()))) {
+            return false;
+        }
+
+        return write_file(root / "cgroup.subtree_control", enable);
+#else
+        return false;
+#endif
+    }
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "errors.hpp"
+#include <string>
+#include <vector>
+
+struct CliOptions {
+    bool help = false;
+    bool list = false;
+    bool check = false;
+    std::string emit;
+    bool complete = false;
+    // Filter for -l and --complete
+    std::string query;
+    bool quiet = false;
+    bool resume = false;
+    std::string envName;
+    std::vector<std::string> taskNames;
+};
+
+inline CliOptions parse_args(const std::vector<std::string> &args) {
+    CliOptions options;
+
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string &arg = args[i];
+
+        if (arg == "-h" || arg == "--help") {
+            options.help = true;
+        } else if (arg == "-l" || arg == "--list") {
+            options.list = true;
+        } else if (arg == "--check") {
+            options.check = true;
+        } else if (arg == "--complete") {
+            options.complete = true;
+        } else if (arg == "--emit") {
+            if (i + 1 >= args.size() || (args[i + 1] != "ninja" && args[i + 1] != "make")) {
+                throw ArgError();
+            }
+            options.emit = args[++i];
+        } else if (arg == "-q" || arg == "--quiet") {
+            options.quiet = true;
+        } else if (arg == "-r" || arg == "--resume") {
+            options.resume = true;
+        } else if (arg == "-e" || arg == "--environment") {
+            if (i + 1 >= args.size() || !options.envName.empty()) {
+                throw ArgError();
+            }
+            options.envName = args[++i];
+        } else if (!arg.empty() && arg[0] == '-') {
+            throw ArgError();
+        } else {
+            options.taskNames.push_back(arg);
+        }
+    }
+
+    if (options.help) {
+        return options;
+    }
+
+    if ((options.list || options.complete) && options.taskNames.size() <= 1) {
+        options.query = options.taskNames.empty() ? "" : options.taskNames.front();
+        options.taskNames.clear();
+    }
+
+    int modes = options.list + options.check + !options.emit.empty() + options.complete;
+    if (modes > 1 || (modes == 1) == !options.taskNames.empty()) {
+        throw ArgError();
+    }
+
+    return options;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -10,6 +11,23 @@ struct Task {
     std::string desc;
     std::vector<std::string> alias;
     std::vector<std::string> needs;
+    std::string pipe;
+
+    // Files the task reads and writes, only used when emitting a build file
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+
+    // Resource controls applied to the spawned process
+    std::optional<int> nice;
+    std::vector<int> cpuset;
+    std::string cpuMax;    // cgroup v2 cpu.max format: "<quota> <period>"
+    std::string memoryMax; // bytes or "max"
+
+    // Long-running process that is started once, kept alive for the rest of the run and stopped when it ends
+    bool service = false;
+    std::string ready;    // probe command, the service is ready once it exits with 0
+    std::string endpoint; // exported to the tasks started after the service as TASKR_SERVICE_<NAME>
+    int readyTimeout = 30; // seconds
 };
 
 struct Environment {
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "config.h"
+#include "errors.hpp"
+#include <algorithm>
+#include <csignal>
+#include <format>
+#include <map>
+#include <string>
+#include <vector>
+
+// Turns the tasks of a config into a ninja or make build file, so an existing scheduler can run the task graph.
+// Every task becomes an edge with its needs as order-only dependencies and its inputs/outputs as real files.
+// nice, cpuset, cpu_max and memory_max are not carried over, and services can't be emitted since they never finish.
+// The config has to outlive the emitter
+class BuildFileEmitter {
+  public:
+    BuildFileEmitter(const Config &config, const std::map<std::string, std::string> &env) {
+        for (const auto &[key, value] : env) {
+            envPrefix += key + "=" + shell_quote(value) + " ";
+        }
+        if (!envPrefix.empty()) {
+            envPrefix = "env " + envPrefix;
+        }
+
+        for (const auto &kv : config.tasks) {
+            if (kv.second.service) {
+                throw TaskrError(std::format("Service '{}' cannot be emitted to a build file", kv.second.name));
+            }
+            tasks.push_back(&kv.second);
+        }
+        std::sort(tasks.begin(), tasks.end(), [](const Task *a, const Task *b) { return a->name < b->name; });
+    }
+
+    std::string ninja() const {
+        std::string out = "# Generated by taskr --emit ninja\n\n"
+                          "rule taskr\n"
+                          "  command = $cmd\n"
+                          "  description = $name\n";
+
+        for (const Task *task : tasks) {
+            std::vector<std::string> outputs = task->outputs.empty() ? std::vector{stamp(*task)} : task->outputs;
+
+            out += "\nbuild" + join(outputs, ninja_path) + ": taskr" + join(task->inputs, ninja_path);
+            if (!dependencies(*task).empty()) {
+                out += " ||" + join(dependencies(*task), ninja_path);
+            }
+            out += "\n  cmd = " + dollar_escape(command(*task)) + "\n";
+            out += "  name = " + task->name + "\n";
+
+            out += "build " + task->name + ": phony" + join(outputs, ninja_path) + "\n";
+            for (const auto &alias : task->alias) {
+                out += "build " + alias + ": phony " + task->name + "\n";
+            }
+        }
+        return out;
+    }
+
+    std::string make() const {
+        std::string out = "# Generated by taskr --emit make\n\n.PHONY:";
+        for (const Task *task : tasks) {
+            out += " " + task->name + join(task->alias, make_path);
+        }
+        out += "\n";
+
+        for (const Task *task : tasks) {
+            std::string target = task->name;
+            if (!task->outputs.empty()) {
+                out += "\n" + task->name + ":" + join(task->outputs, make_path) + "\n";
+                target = join(task->outputs, make_path).substr(1) + (task->outputs.size() > 1 ? " &" : "");
+            }
+
+            out += "\n" + target + ":" + join(task->inputs, make_path);
+            if (!dependencies(*task).empty()) {
+                out += " |" + join(dependencies(*task), make_path);
+            }
+            out += "\n\t" + dollar_escape(command(*task)) + "\n";
+
+            for (const auto &alias : task->alias) {
+                out += alias + ": " + task->name + "\n";
+            }
+        }
+        return out;
+    }
+
+  private:
+    std::vector<const Task *> tasks;
+    std::string envPrefix;
+
+    const Task *find_task(const std::string &nameOrAlias) const {
+        for (const Task *task : tasks) {
+            if (task->name == nameOrAlias ||
+                std::find(task->alias.begin(), task->alias.end(), nameOrAlias) != task->alias.end()) {
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    // Pipe sources are part of the same command, from the first producer to the task itself
+    std::vector<const Task *> pipe_chain(const Task &task) const {
+        std::vector<const Task *> chain{&task};
+        while (!chain.front()->pipe.empty()) {
+            const Task *source = find_task(chain.front()->pipe);
+            if (!source || std::find(chain.begin(), chain.end(), source) != chain.end()) {
+                break;
+            }
+            chain.insert(chain.begin(), source);
+        }
+        return chain;
+    }
+
+    // Task names of the needs of every stage in the task's pipe chain
+    std::vector<std::string> dependencies(const Task &task) const {
+        std::vector<std::string> deps;
+        for (const Task *stage : pipe_chain(task)) {
+            for (const auto &need : stage->needs) {
+                const Task *dep = find_task(need);
+                std::string name = dep ? dep->name : need;
+                if (std::find(deps.begin(), deps.end(), name) == deps.end()) {
+                    deps.push_back(name);
+                }
+            }
+        }
+        return deps;
+    }
+
+    // Output of a task without outputs. It is never created, so ninja runs the task every time like taskr does,
+    // even when a file or directory with the task's name exists
+    static std::string stamp(const Task &task) { return ".taskr/stamps/" + task.name; }
+
+    // Pipes fail like the executor's: any failing stage fails the edge, except producers killed by SIGPIPE.
+    // POSIX sh has no pipefail, so every stage writes "<stage>:<status>" to fd 3, which is collected while the
+    // last stage writes to the real stdout on fd 4
+    std::string command(const Task &task) const {
+        std::vector<const Task *> chain = pipe_chain(task);
+
+        std::string script = task.run;
+        if (chain.size() > 1) {
+            std::string pipeline;
+            for (std::size_t i = 0; i < chain.size(); ++i) {
+                pipeline += std::format("{}{{ ({}) 3>&- 4>&-; echo {}:$? >&3; }}", i == 0 ? "" : " | ",
+                                        chain[i]->run, i);
+            }
+            script = std::format("exec 4>&1; status=$({{ {}; }} 3>&1 >&4); for s in $status; do "
+                                 "[ \"${{s#*:}}\" -eq 0 ] || "
+                                 "{{ [ \"${{s%:*}}\" -lt {} ] && [ \"${{s#*:}}\" -eq {} ]; }} || "
+                                 "exit \"${{s#*:}}\"; done",
+                                 pipeline, chain.size() - 1, 128 + SIGPIPE);
+        }
+        return envPrefix + "sh -c " + shell_quote(script);
+    }
+
+    static std::string shell_quote(const std::string &str) {
+        std::string quoted = "'";
+        for (char c : str) {
+            quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+        }
+        return quoted + "'";
+    }
+
+    // Both ninja and make expand variables with $
+    static std::string dollar_escape(const std::string &str) {
+        std::string escaped;
+        for (char c : str) {
+            escaped += c == '$' ? std::string("$$") : std::string(1, c);
+        }
+        return escaped;
+    }
+
+    static std::string ninja_path(const std::string &path) {
+        std::string escaped;
+        for (char c : path) {
+            if (c == '$' || c == ' ' || c == ':') {
+                escaped += '$';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    static std::string make_path(const std::string &path) {
+        std::string escaped;
+        for (char c : path) {
+            if (c == ' ' || c == ':' || c == '#') {
+                escaped += '\\';
+            }
+            escaped += c == '$' ? std::string("$$") : std::string(1, c);
+        }
+        return escaped;
+    }
+
+    // Each item escaped and prefixed with a space
+    static std::string join(const std::vector<std::string> &items, std::string (*escape)(const std::string &)) {
+        std::string joined;
+        for (const auto &item : items) {
+            joined += " " + escape(item);
+        }
+        return joined;
+    }
+};
@@ -32,3 +32,12 @@ class ParseError : public TaskrError {
   public:
     explicit ParseError(const std::string &msg) : TaskrError(std::format("Parse error: {}", msg)) {}
 };
+
+// Execution errors
+class TaskFailedError : public TaskrError {
+  public:
+    explicit TaskFailedError(const std::string &task, int exitCode)
+        : TaskrError(std::format("Task '{}' failed with exit code {}", task, exitCode)), exitCode(exitCode) {}
+
+    const int exitCode;
+};
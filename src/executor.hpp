@@ -1,37 +1,228 @@
 #pragma once
 
+#include "cgroup.hpp"
 #include "config.h"
 #include "errors.hpp"
+#include "journal.hpp"
+#include "lock.hpp"
+#include "process.hpp"
+#include "service.hpp"
+#include "trace.hpp"
+#include "util.hpp"
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <exception>
+#include <fcntl.h>
 #include <format>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+struct ExecutorOptions {
+    // Send task output to log files and only print a status line per task
+    bool quiet = false;
+    // How much of a failed task's log is shown in quiet mode
+    std::size_t failureTailBytes = 16 * 1024;
+
+    // Name of this run's journal in .taskr/journals, no journal is kept when empty
+    std::string journalName;
+    // Fingerprint of the taskrfile and env, a journal written under another fingerprint is not resumed
+    std::string fingerprint;
+    // Skip the tasks that already succeeded in the journaled run
+    bool resume = false;
+};
+
 class TaskrExecutor {
   public:
-    void execute(const Config &config, const std::string &taskName) {
-        std::unordered_set<std::string> visited;
-        execute_task(config, taskName, visited);
+    TaskrExecutor() = default;
+    explicit TaskrExecutor(const ExecutorOptions &options) : options(options) {}
+
+    // Runs the needs closures of all targets as one graph: shared dependencies run once and targets run concurrently
+    void execute(const Config &config, const std::vector<std::string> &taskNames) {
+        std::vector<std::vector<Step>> sequences;
+        for (const auto &taskName : taskNames) {
+            std::unordered_set<std::string> visited;
+            std::vector<Step> sequence;
+            collect_tasks(config, taskName, visited, sequence);
+            sequences.push_back(std::move(sequence));
+        }
+
+        if (!options.journalName.empty()) {
+            // A run without a journal only loses --resume, so it goes on without one
+            try {
+                journal.emplace(options.journalName, options.fingerprint, options.resume);
+            } catch (const TaskrError &) {
+                std::cerr << "Taskr: could not use .taskr/journals, running without a journal" << std::endl;
+            }
+
+            if (journal && options.resume && !journal->resumable()) {
+                std::cout << "Taskr: no run to resume for this taskrfile and env, running everything" << std::endl;
+            }
+        }
+
+        if (sequences.size() == 1) {
+            run_sequence(sequences.front());
+        } else {
+            std::vector<std::thread> workers;
+            for (const auto &sequence : sequences) {
+                workers.emplace_back([this, &sequence] { run_sequence(sequence); });
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+        }
+
+        stop_services();
+
+        if (firstError) {
+            std::rethrow_exception(firstError);
+        }
+
+        if (journal) {
+            journal->remove();
+        }
     }
 
   private:
-    void execute_task(const Config &config, const std::string &taskName, std::unordered_set<std::string> &visited) {
-        if (visited.count(taskName)) {
-            return;
-        }
+    enum TaskState { RUNNING, DONE, FAILED };
+
+    // Tasks started together, each stage's stdout is piped into the next stage's stdin
+    using Step = std::vector<const Task *>;
+
+    ExecutorOptions options;
+    fs::path logDir;
+    CgroupManager cgroups;
+    ServiceManager services;
+    std::optional<RunJournal> journal;
 
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    std::unordered_map<std::string, TaskState> states;
+    std::exception_ptr firstError;
+
+    std::mutex outputMutex;
+    bool lockWarningShown = false;
+
+    // Orders a target's closure depth-first so every step comes after its needs, in the order they are defined
+    void collect_tasks(const Config &config, const std::string &taskName, std::unordered_set<std::string> &visited,
+                       std::vector<Step> &sequence) {
         const Task *task = find_task(config, taskName);
         if (!task) {
             throw TaskrError(std::format("Task not found: {}", taskName));
         }
+        // taskName may be an alias, visited holds the task names
+        if (visited.count(task->name)) {
+            return;
+        }
 
-        visited.insert(task->name);
+        Step step{task};
+        while (!step.front()->pipe.empty()) {
+            const Task *source = find_task(config, step.front()->pipe);
+            if (!source) {
+                throw TaskrError(std::format("Task not found: {}", step.front()->pipe));
+            }
+            if (visited.count(source->name) || std::find(step.begin(), step.end(), source) != step.end()) {
+                throw TaskrError(
+                    std::format("Task '{}' is already used by another pipe or runs on its own", source->name));
+            }
+            step.insert(step.begin(), source);
+        }
+
+        if (step.size() > 1) {
+            for (const Task *stage : step) {
+                if (stage->service) {
+                    throw TaskrError(std::format("Service '{}' cannot be part of a pipe", stage->name));
+                }
+            }
+        }
+
+        for (const Task *stage : step) {
+            visited.insert(stage->name);
+        }
 
-        for (const auto &dep : task->needs) {
-            execute_task(config, dep, visited);
+        for (const Task *stage : step) {
+            for (const auto &dep : stage->needs) {
+                collect_tasks(config, dep, visited, sequence);
+            }
         }
 
-        run(task->run);
+        sequence.push_back(std::move(step));
+    }
+
+    // Walks one target's sequence, steps claimed by another target are waited for instead of run again
+    void run_sequence(const std::vector<Step> &sequence) {
+        for (const Step &step : sequence) {
+            {
+                std::unique_lock lock(stateMutex);
+                stateChanged.wait(lock, [&] {
+                    return firstError || std::none_of(step.begin(), step.end(), [&](const Task *task) {
+                               return states.count(task->name) && states[task->name] == RUNNING;
+                           });
+                });
+
+                if (firstError) {
+                    return;
+                }
+
+                std::size_t claimed = std::count_if(step.begin(), step.end(),
+                                                    [&](const Task *task) { return states.count(task->name); });
+                if (claimed == step.size()) {
+                    continue;
+                }
+                if (claimed > 0) {
+                    auto shared = std::find_if(step.begin(), step.end(),
+                                               [&](const Task *task) { return states.count(task->name); });
+                    firstError = std::make_exception_ptr(TaskrError(
+                        std::format("Task '{}' is already used by another pipe or runs on its own", (*shared)->name)));
+                    stateChanged.notify_all();
+                    return;
+                }
+
+                for (const Task *task : step) {
+                    states[task->name] = RUNNING;
+                }
+            }
+
+            try {
+                if (step.front()->service) {
+                    start_service(*step.front());
+                } else if (journal && std::all_of(step.begin(), step.end(),
+                                           [&](const Task *task) { return journal->has_completed(task->name); })) {
+                    report_skipped(step);
+                } else {
+                    run_locked(step);
+                }
+            } catch (...) {
+                std::lock_guard lock(stateMutex);
+                for (const Task *task : step) {
+                    states[task->name] = FAILED;
+                }
+                if (!firstError) {
+                    firstError = std::current_exception();
+                }
+                stateChanged.notify_all();
+                return;
+            }
+
+            // Services are not journaled, a resumed run needs them running again
+            if (journal && !step.front()->service) {
+                for (const Task *task : step) {
+                    journal->record(task->name);
+                }
+            }
+
+            std::lock_guard lock(stateMutex);
+            for (const Task *task : step) {
+                states[task->name] = DONE;
+            }
+            stateChanged.notify_all();
+        }
     }
 
     const Task *find_task(const Config &config, const std::string &nameOrAlias) const {
@@ -47,5 +238,331 @@ class TaskrExecutor {
         return nullptr;
     }
 
-    void run(const std::string &command) { std::system(command.c_str()); }
+    // Runs the step unless another taskr process in this project already runs it, then its exit status is reused.
+    // A result is only reused from a run of the same taskrfile and env, otherwise this process waits and runs the
+    // step itself. A pipe step is locked under the name of its last stage
+    void run_locked(const Step &step) {
+        const Task &task = *step.back();
+
+        std::optional<TaskLock> lock;
+        try {
+            lock.emplace(task.name);
+        } catch (const TaskrError &) {
+            std::lock_guard outputLock(outputMutex);
+            if (!lockWarningShown) {
+                lockWarningShown = true;
+                std::cerr << "Taskr: could not use .taskr/locks, running without task locks" << std::endl;
+            }
+        }
+        if (!lock) {
+            run(step);
+            return;
+        }
+
+        if (!lock->try_acquire()) {
+            std::optional<LockRecord> result = wait_for_holder(*lock, task);
+            if (result) {
+                report_reused(task, *result);
+                return;
+            }
+            // The holder exited without a result, or ran another taskrfile or env, so this process runs the task
+        }
+
+        std::string logPath = options.quiet ? (run_log_dir() / (task.name + ".log")).string() : "";
+        lock->write({.pid = getpid(), .fingerprint = options.fingerprint, .logPath = logPath});
+
+        try {
+            run(step);
+        } catch (const TaskFailedError &e) {
+            lock->write({.pid = getpid(), .done = true, .exitCode = e.exitCode, .fingerprint = options.fingerprint});
+            throw;
+        }
+        lock->write({.pid = getpid(), .done = true, .fingerprint = options.fingerprint});
+    }
+
+    // Polls the lock until the holder releases it, and meanwhile streams the holder's log if it has one and this run
+    // is not quiet. The record in the lock file may still be an old one until the holder writes its own, so a result
+    // is only returned when this process saw the holder's running record with a matching fingerprint first
+    std::optional<LockRecord> wait_for_holder(TaskLock &lock, const Task &task) {
+        LockRecord record = lock.read();
+        {
+            std::lock_guard outputLock(outputMutex);
+            if (record.done) {
+                std::cout << std::format("Taskr: '{}' is already running in another process, waiting for it\n",
+                                         task.name);
+            } else {
+                std::cout << std::format("Taskr: '{}' is already running in process {}, waiting for it\n",
+                                         task.name, record.pid);
+            }
+            std::cout << std::flush;
+        }
+
+        std::optional<pid_t> holder;
+        std::ifstream log;
+        char buffer[4096];
+        bool acquired = false;
+        while (!acquired) {
+            acquired = lock.try_acquire();
+            record = lock.read();
+
+            if (!holder && !record.done && record.pid > 0) {
+                holder = record.pid;
+                if (!options.quiet && !record.logPath.empty() && record.fingerprint == options.fingerprint) {
+                    log.open(record.logPath, std::ios::binary);
+                }
+            }
+
+            while (log.is_open() && (log.read(buffer, sizeof(buffer)), log.gcount() > 0)) {
+                std::lock_guard outputLock(outputMutex);
+                std::cout.write(buffer, log.gcount()) << std::flush;
+            }
+            log.clear();
+
+            if (!acquired) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+
+        if (holder && record.done && record.pid == *holder && record.fingerprint == options.fingerprint) {
+            return record;
+        }
+        return std::nullopt;
+    }
+
+    void report_skipped(const Step &step) {
+        std::lock_guard outputLock(outputMutex);
+        for (const Task *task : step) {
+            if (options.quiet) {
+                std::cout << std::format("[skip] {} (succeeded in the resumed run)\n", task->name);
+            } else {
+                std::cout << std::format("Taskr: skipping '{}', it succeeded in the resumed run\n", task->name);
+            }
+        }
+        std::cout << std::flush;
+    }
+
+    void report_reused(const Task &task, const LockRecord &result) {
+        {
+            std::lock_guard outputLock(outputMutex);
+            if (options.quiet && result.exitCode == 0) {
+                std::cout << std::format("[ ok ] {} (reused from process {})\n", task.name, result.pid);
+            } else if (options.quiet) {
+                std::cout << std::format("[FAIL] {} (exit {}, reused from process {})\n", task.name, result.exitCode,
+                                         result.pid);
+            } else {
+                std::cout << std::format("Taskr: reusing result of '{}' from process {}\n", task.name, result.pid);
+            }
+            std::cout << std::flush;
+        }
+
+        if (result.exitCode != 0) {
+            throw TaskFailedError(task.name, result.exitCode);
+        }
+    }
+
+    // Starts all stages of a step at once and fails like `set -o pipefail` when any of them fails.
+    // In quiet mode children write straight into their log file, so output never passes through taskr itself
+    void run(const Step &step) {
+        std::vector<pid_t> pids;
+        std::vector<std::string> logPaths;
+        std::vector<fs::path> cgroupPaths;
+        int stdinFd = -1;
+        int pipeFds[2] = {-1, -1};
+        int logFd = -1;
+        auto close_fd = [](int &fd) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        try {
+            for (std::size_t i = 0; i < step.size(); ++i) {
+                SpawnOptions spawn;
+                spawn.stdinFd = stdinFd;
+                spawn.nice = step[i]->nice;
+                spawn.cpuset = step[i]->cpuset;
+                spawn.env = services.environment();
+
+                cgroupPaths.emplace_back();
+                if (!step[i]->cpuMax.empty() || !step[i]->memoryMax.empty()) {
+                    cgroupPaths.back() = cgroups.create(*step[i]);
+                    if (!cgroupPaths.back().empty()) {
+                        spawn.cgroupProcs = (cgroupPaths.back() / "cgroup.procs").string();
+                    }
+                }
+
+                if (i + 1 < step.size()) {
+                    open_pipe(pipeFds);
+                    spawn.stdoutFd = pipeFds[1];
+                }
+
+                if (options.quiet) {
+                    logPaths.push_back((run_log_dir() / (step[i]->name + ".log")).string());
+                    logFd = open(logPaths.back().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                    if (logFd < 0) {
+                        throw TaskrError(std::format("Could not create log file: {}", logPaths.back()));
+                    }
+                    if (spawn.stdoutFd < 0) {
+                        spawn.stdoutFd = logFd;
+                    }
+                    spawn.stderrFd = logFd;
+                }
+
+                Tracer::instance().phase_once("first spawn");
+                pids.push_back(spawn_shell(step[i]->run, spawn));
+
+                close_fd(stdinFd);
+                close_fd(pipeFds[1]);
+                close_fd(logFd);
+                std::swap(stdinFd, pipeFds[0]);
+            }
+        } catch (...) {
+            // Stages that already started are stopped and reaped, so neither they nor their fds outlive the step
+            for (int *fd : {&stdinFd, &pipeFds[0], &pipeFds[1], &logFd}) {
+                close_fd(*fd);
+            }
+            for (pid_t pid : pids) {
+                kill(pid, SIGTERM);
+                wait_exit_code(pid);
+            }
+            for (const auto &cgroup : cgroupPaths) {
+                if (!cgroup.empty()) {
+                    cgroups.remove(cgroup);
+                }
+            }
+            throw;
+        }
+
+        std::vector<int> exitCodes;
+        for (pid_t pid : pids) {
+            exitCodes.push_back(wait_exit_code(pid));
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::size_t failed = failed_stage(exitCodes);
+
+        for (std::size_t i = 0; i < step.size(); ++i) {
+            if (cgroupPaths[i].empty()) {
+                continue;
+            }
+
+            CgroupUsage usage = cgroups.usage(cgroupPaths[i]);
+            cgroups.remove(cgroupPaths[i]);
+
+            std::lock_guard lock(outputMutex);
+            std::cout << std::format("Taskr: '{}' used {:.2f}s cpu, {:.1f} MiB peak memory\n", step[i]->name,
+                                     usage.cpuSeconds, static_cast<double>(usage.peakMemoryBytes) / (1024 * 1024))
+                      << std::flush;
+        }
+
+        if (options.quiet) {
+            std::lock_guard lock(outputMutex);
+            for (std::size_t i = 0; i < step.size(); ++i) {
+                if (exitCodes[i] == 0) {
+                    std::cout << std::format("[ ok ] {} ({:.2f}s)\n", step[i]->name, elapsed.count());
+                } else {
+                    std::cout << std::format("[FAIL] {} (exit {}, {:.2f}s) -> {}\n", step[i]->name, exitCodes[i],
+                                             elapsed.count(), logPaths[i]);
+                }
+            }
+            if (failed < step.size()) {
+                std::cout << read_file_tail(logPaths[failed], options.failureTailBytes);
+            }
+            std::cout << std::flush;
+        }
+
+        if (failed < step.size()) {
+            throw TaskFailedError(step[failed]->name, exitCodes[failed]);
+        }
+    }
+
+    // Starts a service and waits until it is ready. It is not locked across taskr processes, every run has its own.
+    // cpu_max and memory_max are not applied to services
+    void start_service(const Task &task) {
+        SpawnOptions spawn;
+        spawn.nice = task.nice;
+        spawn.cpuset = task.cpuset;
+
+        std::string logPath;
+        int logFd = -1;
+        if (options.quiet) {
+            logPath = (run_log_dir() / (task.name + ".log")).string();
+            logFd = open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (logFd < 0) {
+                throw TaskrError(std::format("Could not create log file: {}", logPath));
+            }
+            spawn.stdoutFd = logFd;
+            spawn.stderrFd = logFd;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        try {
+            Tracer::instance().phase_once("first spawn");
+            services.start(task, spawn);
+        } catch (const TaskrError &) {
+            if (logFd >= 0) {
+                close(logFd);
+            }
+            if (options.quiet) {
+                std::lock_guard lock(outputMutex);
+                std::cout << std::format("[FAIL] {} (service not ready) -> {}\n", task.name, logPath)
+                          << read_file_tail(logPath, options.failureTailBytes) << std::flush;
+            }
+            throw;
+        }
+        if (logFd >= 0) {
+            close(logFd);
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::lock_guard lock(outputMutex);
+        if (options.quiet) {
+            std::cout << std::format("[ ok ] {} (service ready, {:.2f}s)\n", task.name, elapsed.count());
+        } else {
+            std::cout << std::format("Taskr: service '{}' is ready ({:.2f}s)\n", task.name, elapsed.count());
+        }
+        std::cout << std::flush;
+    }
+
+    void stop_services() {
+        std::vector<std::string> stopped = services.stop_all();
+
+        std::lock_guard lock(outputMutex);
+        for (const auto &name : stopped) {
+            if (options.quiet) {
+                std::cout << std::format("[stop] {}\n", name);
+            } else {
+                std::cout << std::format("Taskr: stopped service '{}'\n", name);
+            }
+        }
+        std::cout << std::flush;
+    }
+
+    // Producers killed by SIGPIPE only stopped because their reader went away, which is not a failure on its own
+    static std::size_t failed_stage(std::vector<int> &exitCodes) {
+        for (std::size_t i = 0; i + 1 < exitCodes.size(); ++i) {
+            if (exitCodes[i] == 128 + SIGPIPE) {
+                exitCodes[i] = 0;
+            }
+        }
+
+        auto failed = std::find_if(exitCodes.begin(), exitCodes.end(), [](int exitCode) { return exitCode != 0; });
+        return static_cast<std::size_t>(failed - exitCodes.begin());
+    }
+
+    // .taskr/logs/<run>/, created on first use and named after the start time and pid of this run
+    const fs::path &run_log_dir() {
+        std::lock_guard lock(outputMutex);
+        if (logDir.empty()) {
+            std::time_t now = std::time(nullptr);
+            char stamp[32];
+            std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+
+            logDir = taskr_state_dir() / "logs" / std::format("{}-{}", stamp, getpid());
+            fs::create_directories(logDir);
+        }
+        return logDir;
+    }
 };
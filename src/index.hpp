@@ -0,0 +1,241 @@
+#pragma once
+
+#include "errors.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <cctype>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Cheap first pass over a taskrfile that only finds the block headers and aliases, without the regex parser.
+// Running a task then only has to parse the blocks in its needs/pipe closure and the selected env
+class TaskrIndex {
+  public:
+    struct Block {
+        bool isTask = false;
+        bool isDefault = false;
+        std::string name;
+        std::vector<std::string> alias;
+        std::size_t begin = 0; // header line
+        std::size_t end = 0;   // one past the last line
+    };
+
+    explicit TaskrIndex(const std::vector<std::string> &lines) : lines(lines), blocks(scan(lines)) {
+        std::size_t aliasCount = 0;
+        for (const auto &block : blocks) {
+            aliasCount += block.alias.size();
+        }
+        tasks.reserve(blocks.size() + aliasCount);
+
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            add_block(i);
+        }
+        for (std::size_t i = 0; i < blocks.size(); ++i) {
+            for (const auto &alias : blocks[i].alias) {
+                tasks.emplace(alias, i);
+            }
+        }
+    }
+
+    const std::vector<Block> &get_blocks() const { return blocks; }
+
+    std::optional<std::size_t> find_task(const std::string &nameOrAlias) const {
+        auto it = tasks.find(nameOrAlias);
+        if (it == tasks.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    // The default env when envName is empty
+    std::optional<std::size_t> find_env(const std::string &envName) const {
+        auto it = envName.empty() ? std::find_if(environments.begin(), environments.end(),
+                                                 [&](const auto &kv) { return blocks[kv.second].isDefault; })
+                                  : environments.find(envName);
+        if (it == environments.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    // File of the selected env, an empty string when there is none
+    std::string env_file(const std::string &envName) const {
+        auto env = find_env(envName);
+        if (!env) {
+            return "";
+        }
+        auto values = block_values(blocks[*env], "file");
+        return values.empty() ? "" : values.back();
+    }
+
+    // The lines of the targets' needs/pipe closure and the selected env, in file order
+    std::vector<std::string> closure_lines(const std::vector<std::string> &targets, const std::string &envName) const {
+        std::set<std::size_t> selected;
+        std::vector<std::string> pending = targets;
+
+        while (!pending.empty()) {
+            auto block = find_task(pending.back());
+            pending.pop_back();
+            if (!block || !selected.insert(*block).second) {
+                continue;
+            }
+
+            for (const auto &needs : block_values(blocks[*block], "needs")) {
+                for (const auto &dep : split(needs, ',')) {
+                    pending.push_back(dep);
+                }
+            }
+            for (const auto &source : block_values(blocks[*block], "pipe")) {
+                pending.push_back(source);
+            }
+        }
+
+        if (auto env = find_env(envName)) {
+            selected.insert(*env);
+        }
+
+        std::vector<std::string> closure;
+        for (std::size_t block : selected) {
+            closure.insert(closure.end(), lines.begin() + blocks[block].begin, lines.begin() + blocks[block].end);
+        }
+        return closure;
+    }
+
+    // Finds the block headers and the aliases of the task blocks, in a vector of strings or string_views
+    template <typename Lines> static std::vector<Block> scan(const Lines &lines) {
+        std::vector<Block> blocks;
+        for (std::size_t i = 0; i < lines.size(); ++i) {
+            Block block;
+            if (may_be_header(lines[i]) && parse_header(lines[i], block)) {
+                if (!blocks.empty()) {
+                    blocks.back().end = i;
+                }
+                block.begin = i;
+                blocks.push_back(std::move(block));
+                continue;
+            }
+
+            if (!blocks.empty() && blocks.back().isTask) {
+                if (auto value = kv_value(lines[i], "alias")) {
+                    blocks.back().alias = split(*value, ',');
+                }
+            }
+        }
+
+        if (!blocks.empty()) {
+            blocks.back().end = lines.size();
+        }
+        return blocks;
+    }
+
+  private:
+    const std::vector<std::string> &lines;
+    std::vector<Block> blocks;
+    std::unordered_map<std::string, std::size_t> tasks;
+    std::unordered_map<std::string, std::size_t> environments;
+
+    void add_block(std::size_t index) {
+        const Block &block = blocks[index];
+
+        if (block.isTask) {
+            if (!tasks.emplace(block.name, index).second) {
+                throw ParseError("Task '" + block.name + "' is defined more than once");
+            }
+        } else {
+            if (block.isDefault && find_env("")) {
+                throw ParseError("More than 1 default environment found");
+            }
+            if (!environments.emplace(block.name, index).second) {
+                throw ParseError("Environment '" + block.name + "' is defined more than once");
+            }
+        }
+    }
+
+    // Headers start with "task", "env" or "default env", so a line whose first non-blank character can't start one of
+    // them is rejected without parsing it
+    static bool may_be_header(std::string_view line) {
+        std::size_t first = line.find_first_not_of(" \t");
+        return first != std::string::npos && (line[first] == 't' || line[first] == 'e' || line[first] == 'd');
+    }
+
+    // Mirrors the parser's header regexes: "task <name>:", "env <name>:" and "default env <name>:"
+    static bool parse_header(std::string_view line, Block &block) {
+        std::size_t comment = line.find("//");
+        if (comment != std::string_view::npos) {
+            line = line.substr(0, comment);
+        }
+
+        if (consume_keyword(line, "task")) {
+            block.isTask = true;
+        } else {
+            line = skip_whitespace(line);
+            if (consume_keyword(line, "default env")) {
+                block.isDefault = true;
+            } else if (!consume_keyword(line, "env")) {
+                return false;
+            }
+        }
+
+        if (line.empty() || !(std::isalpha(static_cast<unsigned char>(line[0])) || line[0] == '_')) {
+            return false;
+        }
+
+        std::size_t length = 1;
+        while (length < line.size() &&
+               (std::isalnum(static_cast<unsigned char>(line[length])) || line[length] == '_' || line[length] == '-')) {
+            ++length;
+        }
+        block.name = std::string(line.substr(0, length));
+
+        line = skip_whitespace(line.substr(length));
+        return !line.empty() && line.front() == ':';
+    }
+
+    // Value of a "  <key> = <value>" line, mirroring the parser's key/value regexes
+    static std::optional<std::string> kv_value(std::string_view line, std::string_view key) {
+        if (line.substr(0, 2) != "  " || line.substr(2, key.size()) != key) {
+            return std::nullopt;
+        }
+
+        line = skip_whitespace(line.substr(2 + key.size()));
+        if (line.empty() || line.front() != '=') {
+            return std::nullopt;
+        }
+
+        std::string value = trim_whitespace(strip_inline_comment(std::string(line.substr(1))));
+        if (value.empty()) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::vector<std::string> block_values(const Block &block, std::string_view key) const {
+        std::vector<std::string> values;
+        for (std::size_t i = block.begin + 1; i < block.end; ++i) {
+            if (auto value = kv_value(lines[i], key)) {
+                values.push_back(*value);
+            }
+        }
+        return values;
+    }
+
+    static std::string_view skip_whitespace(std::string_view str) {
+        while (!str.empty() && (str.front() == ' ' || str.front() == '\t')) {
+            str.remove_prefix(1);
+        }
+        return str;
+    }
+
+    static bool consume_keyword(std::string_view &str, std::string_view keyword) {
+        if (str.substr(0, keyword.size()) != keyword || str.size() == keyword.size() ||
+            (str[keyword.size()] != ' ' && str[keyword.size()] != '\t')) {
+            return false;
+        }
+        str = skip_whitespace(str.substr(keyword.size()));
+        return true;
+    }
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "errors.hpp"
+#include "util.hpp"
+#include <format>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+// Records which tasks of a run succeeded, so a failed run can be resumed with --resume.
+// Stored in .taskr/journals/<name> as a fingerprint line followed by one completed task per line
+class RunJournal {
+  public:
+    RunJournal(const std::string &name, const std::string &fingerprint, bool resume)
+        : path(taskr_state_dir() / "journals" / name) {
+        std::error_code error;
+        fs::create_directories(path.parent_path(), error);
+        if (error) {
+            throw TaskrError(std::format("Could not create {}: {}", path.parent_path().string(), error.message()));
+        }
+
+        if (resume && fs::exists(path)) {
+            std::vector<std::string> lines = read_lines(path.string());
+            matched = !lines.empty() && lines.front() == "fingerprint " + fingerprint;
+            if (matched) {
+                completed.insert(lines.begin() + 1, lines.end());
+            }
+        }
+
+        file.open(path, std::ios::trunc);
+        if (!file.good()) {
+            throw TaskrError(std::format("Could not write journal: {}", path.string()));
+        }
+        file << "fingerprint " << fingerprint << '\n';
+        for (const auto &task : completed) {
+            file << task << '\n';
+        }
+        file.flush();
+    }
+
+    // Whether an earlier run with the same taskrfile and env left a journal to resume from
+    bool resumable() const { return matched; }
+
+    bool has_completed(const std::string &task) const {
+        std::lock_guard lock(mutex);
+        return completed.count(task);
+    }
+
+    void record(const std::string &task) {
+        std::lock_guard lock(mutex);
+        completed.insert(task);
+        file << task << '\n' << std::flush;
+    }
+
+    // A run that succeeded has nothing left to resume
+    void remove() {
+        std::lock_guard lock(mutex);
+        file.close();
+        std::error_code error;
+        fs::remove(path, error);
+    }
+
+  private:
+    fs::path path;
+    std::ofstream file;
+    bool matched = false;
+    std::unordered_set<std::string> completed;
+    mutable std::mutex mutex;
+};
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "config.h"
+#include "index.hpp"
+#include "util.hpp"
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Best fuzzy score of a task over its name, aliases and description. Descriptions count for half,
+// so a match in a name ranks above the same match in a description
+inline std::optional<int> task_score(const Task &task, const std::string &query) {
+    std::optional<int> best = fuzzy_score(query, task.name);
+
+    for (const auto &alias : task.alias) {
+        auto score = fuzzy_score(query, alias);
+        if (score && (!best || *score > *best)) {
+            best = score;
+        }
+    }
+
+    auto score = fuzzy_score(query, task.desc);
+    if (score && (!best || *score / 2 > *best)) {
+        best = *score / 2;
+    }
+    return best;
+}
+
+// The -l output: tasks sorted by name, or ranked by how well they match the query, then the environments.
+// Built in one string so it is written at once
+inline std::string format_config(const Config &config, const std::string &query) {
+    std::vector<std::pair<int, const Task *>> tasks;
+    tasks.reserve(config.tasks.size());
+    for (const auto &kv : config.tasks) {
+        if (auto score = task_score(kv.second, query)) {
+            tasks.emplace_back(query.empty() ? 0 : *score, &kv.second);
+        }
+    }
+    std::sort(tasks.begin(), tasks.end(), [](const auto &a, const auto &b) {
+        return a.first != b.first ? a.first > b.first : a.second->name < b.second->name;
+    });
+
+    std::string out;
+
+    if (!tasks.empty()) {
+        size_t max_task_name_len = 0;
+        for (const auto &t : tasks) {
+            max_task_name_len = std::max(max_task_name_len, t.second->name.length());
+        }
+
+        out += "Tasks:\n";
+        for (const auto &t : tasks) {
+            size_t padding = max_task_name_len - t.second->name.length();
+            out += "  " + t.second->name + std::string(padding + 4, ' ') + t.second->desc + "\n";
+        }
+    }
+
+    if (query.empty() && !config.environments.empty()) {
+        std::vector<const Environment *> environments;
+        size_t max_env_name_len = 0;
+        for (const auto &e : config.environments) {
+            environments.push_back(&e.second);
+            max_env_name_len = std::max(max_env_name_len, e.second.name.length());
+        }
+        std::sort(environments.begin(), environments.end(),
+                  [](const Environment *a, const Environment *b) { return a->name < b->name; });
+
+        out += (tasks.empty() ? "" : "\n") + std::string("Environments:\n");
+        for (const Environment *e : environments) {
+            size_t padding = max_env_name_len - e->name.length();
+            out += (e->isDefault ? "* " : "  ") + e->name + std::string(padding + 4, ' ') + e->file + "\n";
+        }
+    }
+
+    if (config.tasks.empty() && config.environments.empty())
+        out += "Config file is empty\n";
+    else if (!query.empty() && tasks.empty())
+        out += "No tasks match '" + query + "'\n";
+
+    return out;
+}
+
+// Task names and aliases of a taskrfile, sorted and one per line. Uses the index's scan, so it never runs the parser
+inline std::string task_names(std::string_view content) {
+    std::vector<std::string_view> lines;
+    while (!content.empty()) {
+        std::size_t newline = content.find('\n');
+        lines.push_back(content.substr(0, newline));
+        content.remove_prefix(newline == std::string_view::npos ? content.size() : newline + 1);
+    }
+
+    std::vector<std::string> names;
+    for (auto &block : TaskrIndex::scan(lines)) {
+        if (block.isTask) {
+            names.push_back(std::move(block.name));
+            names.insert(names.end(), block.alias.begin(), block.alias.end());
+        }
+    }
+    std::sort(names.begin(), names.end());
+
+    std::string out;
+    for (const auto &name : names) {
+        out += name + "\n";
+    }
+    return out;
+}
+
+// task_names of the taskrfile, kept in .taskr/completion next to the taskrfile under its path, size and modification
+// time, so completion only reads that list until the taskrfile changes. Completion runs on every Tab press from any
+// directory, so it never creates .taskr itself: without an existing, writable one it scans every time
+inline std::string cached_task_names(const std::string &filename) {
+    const fs::path stateDir = fs::absolute(filename).parent_path() / ".taskr";
+    const fs::path cachePath = stateDir / "completion";
+    const std::string stamp = std::format("{} {} {}\n", fs::absolute(filename).string(), fs::file_size(filename),
+                                          fs::last_write_time(filename).time_since_epoch().count());
+
+    std::error_code error;
+    if (fs::exists(cachePath, error)) {
+        std::string cache = read_file(cachePath.string());
+        if (cache.starts_with(stamp)) {
+            return cache.erase(0, stamp.size());
+        }
+    }
+
+    std::string names = task_names(read_file(filename));
+
+    if (!fs::is_directory(stateDir, error)) {
+        return names;
+    }
+    std::ofstream out(cachePath.string() + ".tmp", std::ios::trunc);
+    out << stamp << names;
+    out.close();
+    if (out.good()) {
+        fs::rename(cachePath.string() + ".tmp", cachePath, error);
+    }
+    return names;
+}
+
+// Names for shell completion, one per line: all of them, or the ones matching the query ranked best first
+inline std::string complete_task_names(std::string_view names, const std::string &query) {
+    if (query.empty()) {
+        return std::string(names);
+    }
+
+    std::vector<std::pair<int, std::string_view>> matches;
+    while (!names.empty()) {
+        std::size_t newline = names.find('\n');
+        std::string_view name = names.substr(0, newline);
+        names.remove_prefix(newline == std::string_view::npos ? names.size() : newline + 1);
+
+        if (auto score = fuzzy_score(query, name)) {
+            matches.emplace_back(*score, name);
+        }
+    }
+    // The names are sorted, so a stable sort keeps equal scores in name order
+    std::stable_sort(matches.begin(), matches.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    std::string out;
+    for (const auto &match : matches) {
+        out.append(match.second).push_back('\n');
+    }
+    return out;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "errors.hpp"
+#include "util.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <format>
+#include <sstream>
+#include <string>
+#include <sys/file.h>
+#include <unistd.h>
+
+// What the process holding a task lock is doing, stored in the lock file as "<pid> running <fingerprint> [log]" or
+// "<pid> done <exit code> <fingerprint>". The fingerprint tells runs of another taskrfile or env apart. The log path
+// is the rest of the line, as the project path may contain spaces
+struct LockRecord {
+    pid_t pid = 0;
+    bool done = false;
+    int exitCode = 0;
+    std::string fingerprint;
+    std::string logPath;
+};
+
+inline std::string format_lock_record(const LockRecord &record) {
+    const std::string fingerprint = record.fingerprint.empty() ? "-" : record.fingerprint;
+    if (record.done) {
+        return std::format("{} done {} {}\n", record.pid, record.exitCode, fingerprint);
+    }
+    return std::format("{} running {} {}\n", record.pid, fingerprint, record.logPath);
+}
+
+inline LockRecord parse_lock_record(const std::string &str) {
+    LockRecord record;
+    std::istringstream stream(str);
+    std::string state;
+
+    stream >> record.pid >> state;
+    if (state == "done") {
+        record.done = true;
+        stream >> record.exitCode >> record.fingerprint;
+    } else {
+        stream >> record.fingerprint >> std::ws;
+        std::getline(stream, record.logPath);
+    }
+    if (record.fingerprint == "-") {
+        record.fingerprint.clear();
+    }
+    return record;
+}
+
+// flock on .taskr/locks/<task>.lock, so concurrent taskr runs in one project don't run the same task twice.
+// The lock is released by the kernel when its holder exits, however it exits, so a held lock always has a live holder
+class TaskLock {
+  public:
+    explicit TaskLock(const std::string &taskName) {
+        fs::path dir = taskr_state_dir() / "locks";
+        std::error_code error;
+        fs::create_directories(dir, error);
+        if (error) {
+            throw TaskrError(std::format("Could not create {}: {}", dir.string(), error.message()));
+        }
+
+        const std::string path = (dir / (taskName + ".lock")).string();
+        fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw TaskrError(std::format("Could not open lock file: {}", path));
+        }
+    }
+
+    TaskLock(const TaskLock &) = delete;
+    TaskLock &operator=(const TaskLock &) = delete;
+
+    ~TaskLock() { close(fd); }
+
+    bool try_acquire() { return flock(fd, LOCK_EX | LOCK_NB) == 0; }
+
+    LockRecord read() const {
+        std::string content(PATH_MAX + 64, '\0');
+        ssize_t size = pread(fd, content.data(), content.size(), 0);
+        content.resize(size > 0 ? static_cast<std::size_t>(size) : 0);
+        return parse_lock_record(content);
+    }
+
+    void write(const LockRecord &record) {
+        std::string content = format_lock_record(record);
+        if (ftruncate(fd, 0) < 0 || pwrite(fd, content.data(), content.size(), 0) < 0) {
+            throw TaskrError(std::format("Could not write lock file: {}", std::strerror(errno)));
+        }
+    }
+
+  private:
+    int fd;
+};
@@ -1,154 +1,187 @@
+#include "cli.hpp"
+#include "emit.hpp"
 #include "errors.hpp"
 #include "executor.hpp"
+#include "index.hpp"
+#include "listing.hpp"
 #include "parser.hpp"
+#include "trace.hpp"
 #include "util.hpp"
+#include <cstdlib>
 #include <format>
-#include <fstream>
+#include <future>
 #include <iostream>
 #include <ostream>
+#include <new>
 #include <unordered_set>
 
+#ifdef TASKR_COUNT_ALLOCATIONS
+// Counts allocations for TASKR_TRACE. The deletes are not inlined, otherwise GCC sees free() called on memory from
+// operator new at the call sites and warns with -Wmismatched-new-delete
+void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
 void print_help() {
     std::cout << R"(Usage:
-  taskr <task_name> [options]
+  taskr <task_name>... [options]
 
 Options:
   -h, --help                Show this help message and exit
-  -l, --list                List the available tasks
+  -l, --list [query]        List the available tasks, ranked by a fuzzy match on the query if given
   -e, --environment name    Select the environment to use
+  -q, --quiet               Write task output to .taskr/logs and only show a status line per task
+  -r, --resume              Skip the tasks that succeeded in the last failed run of the same tasks
+      --check               Validate the whole taskrfile and exit
+      --emit ninja|make     Print the tasks as a ninja or make build file
+      --complete [query]    Print task names and aliases for shell completion
 )";
 }
 
-void print_config(const Config &config) {
-    size_t max_task_name_len = 0;
-    for (const auto &c : config.tasks) {
-        max_task_name_len = std::max(max_task_name_len, c.second.name.length());
+// The -e environment, or the default one when none is given
+const Environment *select_env(const Config &config, const std::string &envName) {
+    if (envName.empty()) {
+        for (const auto &kv : config.environments) {
+            if (kv.second.isDefault) {
+                return &kv.second;
+            }
+        }
+        return nullptr;
     }
 
-    if (!config.tasks.empty()) {
-        std::cout << "Tasks:" << std::endl;
-        for (const auto &t : config.tasks) {
-            size_t padding = max_task_name_len - t.second.name.length();
-            std::cout << "  " << t.second.name << std::string(padding + 4, ' ') << t.second.desc << std::endl;
-        }
+    if (config.environments.find(envName) == config.environments.end()) {
+        throw TaskrError(std::format("No environment '{}' found in config", envName));
     }
+    return &config.environments.at(envName);
+}
 
-    if (!config.environments.empty()) {
-        size_t max_env_name_len = 0;
-        for (const auto &e : config.environments) {
-            max_env_name_len = std::max(max_env_name_len, e.second.name.length());
-        }
+// One journal per combination of targets and env, so `taskr --resume test` finds the journal of `taskr test`
+std::string journal_name(const CliOptions &options) {
+    std::uint64_t hash = fnv1a_hash(options.envName);
+    for (const auto &taskName : options.taskNames) {
+        hash = fnv1a_hash(" " + taskName, hash);
+    }
+    return std::format("{:016x}", hash);
+}
 
-        std::cout << std::endl << "Environments:" << std::endl;
-        for (const auto &e : config.environments) {
-            size_t padding = max_env_name_len - e.second.name.length();
-            if (e.second.isDefault) {
-                std::cout << "* " << e.second.name << std::string(padding + 4, ' ') << e.second.file << std::endl;
-            } else {
-                std::cout << "  " << e.second.name << std::string(padding + 4, ' ') << e.second.file << std::endl;
-            }
+std::string fingerprint(const std::vector<std::string> &lines, const Environment *env,
+                        const std::vector<std::string> &envLines) {
+    std::uint64_t hash = fnv1a_hash("");
+    for (const auto &line : lines) {
+        hash = fnv1a_hash("\n", fnv1a_hash(line, hash));
+    }
+    if (env) {
+        hash = fnv1a_hash("env " + env->name + "\n", hash);
+        for (const auto &line : envLines) {
+            hash = fnv1a_hash("\n", fnv1a_hash(line, hash));
         }
     }
-
-    if (config.tasks.empty() && config.environments.empty())
-        std::cout << "Config file is empty" << std::endl;
+    return std::format("{:016x}", hash);
 }
 
 int main(int argc, char *argv[]) {
-    if (argc == 2 && (std::string(argv[1]) == "-h" || std::string(argv[1]) == "--help")) {
-        print_help();
-        return 0;
-    }
+    Tracer &tracer = Tracer::instance();
 
     try {
-        const std::string filename = check_unique_case_insensitive_match("taskrfile");
+        CliOptions options = parse_args(std::vector<std::string>(argv + 1, argv + argc));
 
-        if (filename.find(".config/taskr") != std::string::npos) {
-            std::cout << "Taskr: Using global config" << std::endl << std::endl;
+        if (options.help) {
+            print_help();
+            return 0;
         }
 
-        TaskrParser parser;
-        EnvParser envParser;
-        TaskrExecutor executor;
+        const std::string filename = check_unique_case_insensitive_match("taskrfile");
+        tracer.phase("config discovery");
 
-        std::string taskName;
-        std::string envName;
+        if (options.complete) {
+            std::cout << complete_task_names(cached_task_names(filename), options.query) << std::flush;
+            tracer.phase("complete");
+            return 0;
+        }
 
-        std::ifstream file(filename);
-        std::vector<std::string> lines;
-        std::string line;
-        while (std::getline(file, line)) {
-            lines.push_back(line);
+        if (filename.find(".config/taskr") != std::string::npos && options.emit.empty()) {
+            std::cout << "Taskr: Using global config" << std::endl << std::endl;
         }
 
-        Config config = parser.parse_lines(lines);
+        const std::string &envName = options.envName;
 
-        if (argc != 2 && argc != 4) {
-            throw ArgError();
-        }
+        std::vector<std::string> lines = read_lines(filename);
+        tracer.phase("file read");
 
-        if (argc == 2 && (std::string(argv[1]) == "-l" || std::string(argv[1]) == "--list")) {
-            print_config(config);
-            return 0;
-        }
+        if (options.list || options.check || !options.emit.empty()) {
+            TaskrParser parser;
+            Config config = parser.parse_lines(lines);
+            tracer.phase("parse_lines");
 
-        if (argc == 2) {
-            taskName = argv[1];
-
-            if (config.hasDefaultEnv) {
-                for (auto kv : config.environments) {
-                    if (kv.second.isDefault) {
-                        std::ifstream file(kv.second.file);
-                        if (!file.good()) {
-                            throw FileNotFoundError(kv.second.file);
-                        }
-                        std::vector<std::string> lines;
-                        std::string line;
-                        while (std::getline(file, line)) {
-                            lines.push_back(line);
-                        }
-                        envParser.load_env(lines, kv.second.file);
-                    }
+            if (options.list) {
+                std::cout << format_config(config, options.query) << std::flush;
+            } else if (options.check) {
+                std::cout << "Taskr: " << filename << " is valid" << std::endl;
+            } else {
+                std::map<std::string, std::string> env;
+                if (const Environment *selected = select_env(config, envName)) {
+                    EnvParser envParser;
+                    const auto &data = envParser.parse_env(read_lines(selected->file), selected->file);
+                    env.insert(data.begin(), data.end());
                 }
+
+                BuildFileEmitter emitter(config, env);
+                std::cout << (options.emit == "ninja" ? emitter.ninja() : emitter.make()) << std::flush;
             }
+            return 0;
         }
 
-        if (argc == 4) {
-            if ((std::string(argv[1]) == "-e" || std::string(argv[1]) == "--environment")) {
-                envName = argv[2];
-                taskName = argv[3];
-            };
-
-            if ((std::string(argv[2]) == "-e" || std::string(argv[2]) == "--environment")) {
-                envName = argv[3];
-                taskName = argv[1];
-            };
+        // Only the blocks in the targets' closure and the selected env are parsed, -l and --check validate everything
+        TaskrIndex index(lines);
+        tracer.phase("index");
 
-            if (config.environments.find(envName) == config.environments.end()) {
-                throw TaskrError(std::format("No environment '{}' found in config", envName));
+        for (const auto &taskName : options.taskNames) {
+            if (!index.find_task(taskName)) {
+                throw TaskrError(std::format("Task or alias '{}' not found", taskName));
             }
+        }
+        tracer.phase("name resolution");
 
-            std::ifstream file(config.environments.at(envName).file);
-            if (!file.good()) {
-                throw FileNotFoundError(config.environments.at(envName).file);
-            }
-            std::vector<std::string> lines;
-            std::string line;
-            while (std::getline(file, line)) {
-                lines.push_back(line);
-            }
-            envParser.load_env(lines, config.environments.at(envName).file);
-        };
+        // The selected env file is read in the background while the parser is set up and the taskrfile is parsed
+        const std::string prefetchedEnvFile = index.env_file(envName);
+        std::future<std::vector<std::string>> prefetchedEnvLines;
+        if (!prefetchedEnvFile.empty()) {
+            prefetchedEnvLines = std::async(std::launch::async, read_lines, prefetchedEnvFile);
+        }
 
-        std::unordered_set<std::string> definedTasksAndAliases = parser.get_task_names_and_aliases();
+        TaskrParser parser;
+        EnvParser envParser;
+        tracer.phase("parser setup");
 
-        auto it = std::find(definedTasksAndAliases.begin(), definedTasksAndAliases.end(), taskName);
+        Config config = parser.parse_lines(index.closure_lines(options.taskNames, envName));
+        tracer.phase("parse_lines");
+        tracer.counter("lines in file", lines.size());
+        tracer.counter("lines parsed", parser.get_stats().lines);
+        tracer.counter("regex evaluations", parser.get_stats().regexEvaluations);
 
-        if (it == definedTasksAndAliases.end()) {
-            throw TaskrError(std::format("Task or alias '{}' not found", taskName));
+        const Environment *env = select_env(config, envName);
+
+        std::vector<std::string> envLines;
+        if (env) {
+            envLines = env->file == prefetchedEnvFile ? prefetchedEnvLines.get() : read_lines(env->file);
+            envParser.load_env(envLines, env->file);
         }
 
-        executor.execute(config, taskName);
+        tracer.phase("env file load");
+
+        TaskrExecutor executor({.quiet = options.quiet,
+                                .journalName = journal_name(options),
+                                .fingerprint = fingerprint(lines, env, envLines),
+                                .resume = options.resume});
+        executor.execute(config, options.taskNames);
 
     } catch (const ArgError &e) {
         std::cerr << e.what() << "\n\n";
@@ -11,6 +11,11 @@
 
 enum TaskrParseState { START, IN_TASK, IN_ENV };
 
+struct ParseStats {
+    std::size_t lines = 0;
+    std::size_t regexEvaluations = 0;
+};
+
 class TaskrParser {
   public:
     Config parse_lines(const std::vector<std::string> &lines) {
@@ -19,12 +24,14 @@ class TaskrParser {
         currentTask = {};
         currentEnv = {};
         currentBlockName = "";
+        stats = {};
 
         Config config;
         int line_number = 0;
 
         for (const std::string &raw_line : lines) {
             ++line_number;
+            ++stats.lines;
             std::string line = raw_line;
 
             if (is_comment(line) || line.empty()) {
@@ -35,7 +42,7 @@ class TaskrParser {
 
             std::smatch match;
 
-            if (std::regex_match(line, match, default_env_header_regex)) {
+            if (count_match(line, match, default_env_header_regex)) {
                 if (state == IN_TASK && !currentTask.name.empty()) {
                     validate_task(currentTask);
                     config.tasks[currentTask.name] = currentTask;
@@ -60,7 +67,7 @@ class TaskrParser {
                 continue;
             }
 
-            if (std::regex_match(line, match, env_header_regex)) {
+            if (count_match(line, match, env_header_regex)) {
                 if (state == IN_TASK && !currentTask.name.empty()) {
                     validate_task(currentTask);
                     config.tasks[currentTask.name] = currentTask;
@@ -80,7 +87,7 @@ class TaskrParser {
                 continue;
             }
 
-            if (std::regex_match(line, match, task_header_regex)) {
+            if (count_match(line, match, task_header_regex)) {
                 if (state == IN_TASK && !currentTask.name.empty()) {
                     validate_task(currentTask);
                     config.tasks[currentTask.name] = currentTask;
@@ -122,6 +129,8 @@ class TaskrParser {
 
     std::unordered_set<std::string> get_task_names_and_aliases() { return definedTaskNames; };
 
+    const ParseStats &get_stats() const { return stats; }
+
   private:
     TaskrParseState state = START;
     Task currentTask;
@@ -131,16 +140,27 @@ class TaskrParser {
     std::unordered_set<std::string> definedTaskNames;
     std::unordered_set<std::string> definedEnvNames;
 
+    ParseStats stats;
+
     std::regex comment_regex{R"(\s*//.*)"};
 
     std::regex task_header_regex{R"(task\s+([a-zA-Z_][\w\-]*)\s*:\s*(.*))"};
-    std::regex task_kv_regex{R"(^(  )(run|desc|alias|needs)\s*=\s*(.+))"};
+    std::regex task_kv_regex{R"(^(  )(run|desc|alias|needs|pipe|inputs|outputs|nice|cpuset|cpu_max|memory_max|)"
+                             R"(service|ready|endpoint|ready_timeout)\s*=\s*(.+))"};
 
     std::regex env_header_regex{R"(\s*(env)\s+([a-zA-Z_][\w\-]*)\s*:\s*(.*))"};
     std::regex default_env_header_regex{R"(\s*(default env)\s+([a-zA-Z_][\w\-]*)\s*:\s*(.*))"};
     std::regex env_kv_regex{R"(^(  )(file)\s*=\s*(.+))"};
 
-    bool is_comment(const std::string &line) const { return std::regex_match(line, comment_regex); }
+    bool is_comment(const std::string &line) {
+        std::smatch match;
+        return count_match(line, match, comment_regex);
+    }
+
+    bool count_match(const std::string &line, std::smatch &match, const std::regex &regex) {
+        ++stats.regexEvaluations;
+        return std::regex_match(line, match, regex);
+    }
 
     bool is_task_header(const std::string &line) const { return std::regex_match(line, task_header_regex); }
     bool is_env_header(const std::string &line) const { return std::regex_match(line, env_header_regex); }
@@ -154,7 +174,7 @@ class TaskrParser {
     void handle_kv_line(const std::string &line) {
         std::smatch match;
 
-        if (state == IN_TASK && std::regex_match(line, match, task_kv_regex)) {
+        if (state == IN_TASK && count_match(line, match, task_kv_regex)) {
             std::string key = match[2];
             std::string value = trim_whitespace(match[3]);
 
@@ -166,9 +186,31 @@ class TaskrParser {
                 currentTask.alias = split(value, ',');
             else if (key == "needs")
                 currentTask.needs = split(value, ',');
+            else if (key == "pipe")
+                currentTask.pipe = value;
+            else if (key == "inputs")
+                currentTask.inputs = split(value, ',');
+            else if (key == "outputs")
+                currentTask.outputs = split(value, ',');
+            else if (key == "nice")
+                currentTask.nice = parse_task_value(key, value, parse_int(value, -20, 19));
+            else if (key == "cpuset")
+                currentTask.cpuset = parse_task_value(key, value, parse_cpu_list(value));
+            else if (key == "cpu_max")
+                currentTask.cpuMax = parse_task_value(key, value, parse_cpu_max(value));
+            else if (key == "memory_max")
+                currentTask.memoryMax = parse_task_value(key, value, parse_memory_max(value));
+            else if (key == "service")
+                currentTask.service = parse_task_value(key, value, parse_bool(value));
+            else if (key == "ready")
+                currentTask.ready = value;
+            else if (key == "endpoint")
+                currentTask.endpoint = value;
+            else if (key == "ready_timeout")
+                currentTask.readyTimeout = parse_task_value(key, value, parse_int(value, 1, 3600));
         }
 
-        if (state == IN_ENV && std::regex_match(line, match, env_kv_regex)) {
+        if (state == IN_ENV && count_match(line, match, env_kv_regex)) {
             std::string key = match[2];
             std::string value = trim_whitespace(match[3]);
 
@@ -177,6 +219,14 @@ class TaskrParser {
         }
     };
 
+    template <typename T>
+    T parse_task_value(const std::string &key, const std::string &value, const std::optional<T> &parsed) const {
+        if (!parsed) {
+            throw ParseError("Task '" + currentTask.name + "' has an invalid value for '" + key + "': " + value);
+        }
+        return *parsed;
+    }
+
     void validate_task(const Task &task) {
         if (definedTaskNames.count(task.name)) {
             throw ParseError("Task '" + task.name + "' is defined more than once");
@@ -198,6 +248,14 @@ class TaskrParser {
             throw ParseError("Task '" + task.name + "' is missing required key: 'run'");
         }
 
+        if (!task.service && (!task.ready.empty() || !task.endpoint.empty())) {
+            throw ParseError("Task '" + task.name + "' sets 'ready' or 'endpoint' but is not a service");
+        }
+
+        if (task.service && !task.pipe.empty()) {
+            throw ParseError("Service '" + task.name + "' cannot read from a pipe");
+        }
+
         definedTaskNames.insert(task.name);
 
         for (const std::string &alias : task.alias) {
@@ -209,6 +267,10 @@ class TaskrParser {
                 throw ParseError("Dependency '" + dependency + "' could not be resolved");
             }
         }
+
+        if (!task.pipe.empty() && !definedTaskNames.count(task.pipe)) {
+            throw ParseError("Pipe source '" + task.pipe + "' could not be resolved");
+        }
     }
 
     void validate_env(const Environment &env) {
@@ -226,7 +288,9 @@ class TaskrParser {
 
 class EnvParser {
   public:
-    void load_env(const std::vector<std::string> &lines, const std::string &filename) {
+    // Parses an env file without exporting its variables
+    const std::unordered_map<std::string, std::string> &parse_env(const std::vector<std::string> &lines,
+                                                                  const std::string &filename) {
         for (const std::string &line : lines) {
             if (line.empty() || line[0] == '#' || line[0] == ';') {
                 continue;
@@ -246,6 +310,12 @@ class EnvParser {
             data[key] = value;
         }
 
+        return data;
+    }
+
+    void load_env(const std::vector<std::string> &lines, const std::string &filename) {
+        parse_env(lines, filename);
+
         for (auto kv : data) {
             set_env_var(kv.first, kv.second);
         };
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "errors.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <format>
+#include <fcntl.h>
+#include <mutex>
+#include <optional>
+#include <sched.h>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char **environ;
+
+// File descriptors the child gets as stdin/stdout/stderr, -1 inherits taskr's own
+struct SpawnOptions {
+    int stdinFd = -1;
+    int stdoutFd = -1;
+    int stderrFd = -1;
+
+    std::optional<int> nice;
+    std::vector<int> cpuset;
+    // cgroup.procs file of the cgroup the child moves itself into before exec
+    std::string cgroupProcs;
+
+    // Start the child in its own process group, so it can be stopped together with everything it starts
+    bool newProcessGroup = false;
+    // "KEY=value" entries added to taskr's environment
+    std::vector<std::string> env;
+};
+
+#ifndef __linux__
+// Without pipe2, creating a pipe and marking it close-on-exec is not atomic. Forks are serialized with it, so a
+// child forked by another thread never inherits a pipe end before it is marked
+inline std::mutex forkMutex;
+#endif
+
+// Pipe whose ends are not inherited by other children, a stray write end would keep the reader from seeing EOF
+inline void open_pipe(int fds[2]) {
+#ifdef __linux__
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+        throw TaskrError(std::format("Could not create pipe: {}", std::strerror(errno)));
+    }
+#else
+    std::lock_guard lock(forkMutex);
+    if (pipe(fds) < 0) {
+        throw TaskrError(std::format("Could not create pipe: {}", std::strerror(errno)));
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+}
+
+// Setup steps in the forked child that can fail
+enum SpawnStep { JOIN_CGROUP, SET_NICE, SET_CPUSET, EXEC_SHELL };
+
+struct SpawnFailure {
+    SpawnStep step;
+    int error;
+};
+
+inline const char *spawn_step_description(SpawnStep step) {
+    switch (step) {
+    case JOIN_CGROUP:
+        return "join cgroup";
+    case SET_NICE:
+        return "set nice level";
+    case SET_CPUSET:
+        return "set cpuset";
+    case EXEC_SHELL:
+        return "start /bin/sh";
+    }
+    return "start process";
+}
+
+inline pid_t spawn_shell(const std::string &command, const SpawnOptions &options = {}) {
+    // Built before forking, the child of a threaded process should not allocate.
+    // Inherited variables that options.env sets again are left out, getenv would return the inherited value first
+    std::vector<char *> envp;
+    for (char **var = environ; *var; ++var) {
+        std::string_view inherited(*var);
+        bool replaced = std::any_of(options.env.begin(), options.env.end(), [&](const std::string &entry) {
+            std::size_t keyEnd = entry.find('=');
+            return inherited.substr(0, keyEnd + 1) == std::string_view(entry).substr(0, keyEnd + 1);
+        });
+        if (!replaced) {
+            envp.push_back(*var);
+        }
+    }
+    for (const auto &var : options.env) {
+        envp.push_back(const_cast<char *>(var.c_str()));
+    }
+    envp.push_back(nullptr);
+
+    // The child reports setup failures through this pipe instead of formatting messages itself, which is not safe
+    // between fork and exec in a threaded process. It closes on exec, so EOF means the shell has started
+    int errorFds[2];
+    open_pipe(errorFds);
+
+#ifndef __linux__
+    std::unique_lock forkLock(forkMutex);
+#endif
+    pid_t pid = fork();
+    if (pid < 0) {
+        int error = errno;
+        close(errorFds[0]);
+        close(errorFds[1]);
+        throw TaskrError(std::format("Could not start process: {}", std::strerror(error)));
+    }
+
+    if (pid == 0) {
+        auto report = [&](SpawnStep step) {
+            SpawnFailure failure{step, errno};
+            (void)!write(errorFds[1], &failure, sizeof(failure));
+        };
+
+        if (options.newProcessGroup)
+            setpgid(0, 0);
+        if (options.stdinFd >= 0)
+            dup2(options.stdinFd, STDIN_FILENO);
+        if (options.stdoutFd >= 0)
+            dup2(options.stdoutFd, STDOUT_FILENO);
+        if (options.stderrFd >= 0)
+            dup2(options.stderrFd, STDERR_FILENO);
+
+        if (!options.cgroupProcs.empty()) {
+            int fd = open(options.cgroupProcs.c_str(), O_WRONLY);
+            if (fd < 0 || write(fd, "0", 1) < 0) {
+                report(JOIN_CGROUP);
+            }
+            if (fd >= 0)
+                close(fd);
+        }
+
+        if (options.nice && setpriority(PRIO_PROCESS, 0, *options.nice) < 0) {
+            report(SET_NICE);
+        }
+
+#ifdef __linux__
+        if (!options.cpuset.empty()) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (int cpu : options.cpuset) {
+                CPU_SET(cpu, &cpus);
+            }
+            if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0) {
+                report(SET_CPUSET);
+            }
+        }
+#endif
+
+        const char *argv[] = {"sh", "-c", command.c_str(), nullptr};
+        execve("/bin/sh", const_cast<char *const *>(argv), envp.data());
+        report(EXEC_SHELL);
+        _exit(127);
+    }
+
+#ifndef __linux__
+    forkLock.unlock();
+#endif
+    close(errorFds[1]);
+
+    // Written where the child's stderr goes, like the child's own output
+    int stderrFd = options.stderrFd >= 0 ? options.stderrFd : STDERR_FILENO;
+    SpawnFailure failure;
+    ssize_t bytes;
+    while ((bytes = read(errorFds[0], &failure, sizeof(failure))) != 0) {
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes != sizeof(failure)) {
+            break;
+        }
+        dprintf(stderrFd, "Taskr: could not %s: %s\n", spawn_step_description(failure.step),
+                std::strerror(failure.error));
+    }
+    close(errorFds[0]);
+
+    return pid;
+}
+
+// Signals are reported as 128 + signal number like a shell does
+inline int exit_code(int status) {
+    if (WIFEXITED(status))
+        return WEXITSTATUS(status);
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return 1;
+}
+
+// Waits for the process and returns its exit code
+inline int wait_exit_code(pid_t pid) {
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            throw TaskrError(std::format("Could not wait for process: {}", std::strerror(errno)));
+        }
+    }
+    return exit_code(status);
+}
+
+// Exit code of the process if it has already exited, without blocking
+inline std::optional<int> try_wait_exit_code(pid_t pid) {
+    int status = 0;
+    pid_t result;
+    while ((result = waitpid(pid, &status, WNOHANG)) < 0 && errno == EINTR) {
+    }
+    if (result <= 0) {
+        return std::nullopt;
+    }
+    return exit_code(status);
+}
@@ -0,0 +1,193 @@
+#pragma once
+
+#include "config.h"
+#include "errors.hpp"
+#include "process.hpp"
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <csignal>
+#include <format>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Process groups of the running services, read from the signal handler so an interrupted taskr still stops them.
+// Services beyond the last slot are only stopped when the run ends normally
+inline std::array<std::atomic<pid_t>, 64> runningServiceGroups{};
+
+inline void stop_services_and_reraise(int signal) {
+    for (auto &group : runningServiceGroups) {
+        pid_t pid = group.load();
+        if (pid > 0) {
+            kill(-pid, SIGTERM);
+        }
+    }
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+// Tasks with `service = true`: started once in their own process group, polled with their ready probe, and kept
+// alive until the run ends. Tasks started after a service see its endpoint as TASKR_SERVICE_<NAME>
+class ServiceManager {
+  public:
+    ServiceManager() = default;
+    ServiceManager(const ServiceManager &) = delete;
+    ServiceManager &operator=(const ServiceManager &) = delete;
+    ~ServiceManager() { stop_all(); }
+
+    // Returns once the ready probe exits with 0, throws when the service exits or times out first.
+    // A service that timed out keeps running until stop_all
+    void start(const Task &task, SpawnOptions spawn) {
+        std::call_once(handlersInstalled, [] {
+            for (int signal : {SIGINT, SIGTERM, SIGHUP}) {
+                std::signal(signal, stop_services_and_reraise);
+            }
+        });
+
+        spawn.newProcessGroup = true;
+        spawn.env = environment();
+        // The child calls setpgid(0, 0) before exec and spawn_shell only returns after the exec, so the group exists
+        // before it can be signalled
+        pid_t pid = spawn_shell(task.run, spawn);
+
+        std::size_t index;
+        {
+            std::lock_guard lock(mutex);
+            index = services.size();
+            services.push_back({task.name, pid, register_group(pid)});
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(task.readyTimeout);
+        while (true) {
+            if (auto exitCode = try_wait_exit_code(pid)) {
+                std::lock_guard lock(mutex);
+                release(services[index]);
+                throw TaskrError(std::format("Service '{}' exited with code {} before it was ready", task.name,
+                                             *exitCode));
+            }
+
+            if (task.ready.empty() || probe(task.ready, spawn.env, deadline)) {
+                break;
+            }
+
+            if (std::chrono::steady_clock::now() >= deadline) {
+                throw TaskrError(std::format("Service '{}' was not ready after {}s", task.name, task.readyTimeout));
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        if (!task.endpoint.empty()) {
+            std::lock_guard lock(mutex);
+            endpoints.push_back(std::format("{}={}", env_name(task.name), task.endpoint));
+        }
+    }
+
+    // "TASKR_SERVICE_<NAME>=<endpoint>" for every ready service with an endpoint
+    std::vector<std::string> environment() {
+        std::lock_guard lock(mutex);
+        return endpoints;
+    }
+
+    // Sends SIGTERM to every service's process group and SIGKILL to the ones still running after the grace period.
+    // Returns the names of the services that were stopped
+    std::vector<std::string> stop_all(std::chrono::milliseconds grace = std::chrono::seconds(5)) {
+        std::lock_guard lock(mutex);
+
+        std::vector<std::string> stopped;
+        for (const auto &service : services) {
+            if (service.pid > 0) {
+                kill(-service.pid, SIGTERM);
+                stopped.push_back(service.name);
+            }
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + grace;
+        for (auto &service : services) {
+            while (service.pid > 0 && !try_wait_exit_code(service.pid)) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    kill(-service.pid, SIGKILL);
+                    waitpid(service.pid, nullptr, 0);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            release(service);
+        }
+
+        services.clear();
+        endpoints.clear();
+        return stopped;
+    }
+
+    // TASKR_SERVICE_ followed by the task name in upper case, with everything but letters and digits as '_'
+    static std::string env_name(const std::string &taskName) {
+        std::string name = "TASKR_SERVICE_";
+        for (unsigned char c : taskName) {
+            name += std::isalnum(c) ? static_cast<char>(std::toupper(c)) : '_';
+        }
+        return name;
+    }
+
+  private:
+    struct Service {
+        std::string name;
+        pid_t pid = 0; // 0 once the service has been reaped
+        std::size_t slot = runningServiceGroups.size();
+    };
+
+    std::mutex mutex;
+    std::vector<Service> services;
+    std::vector<std::string> endpoints;
+    std::once_flag handlersInstalled;
+
+    static std::size_t register_group(pid_t pid) {
+        for (std::size_t slot = 0; slot < runningServiceGroups.size(); ++slot) {
+            pid_t expected = 0;
+            if (runningServiceGroups[slot].compare_exchange_strong(expected, pid)) {
+                return slot;
+            }
+        }
+        return runningServiceGroups.size();
+    }
+
+    static void release(Service &service) {
+        if (service.slot < runningServiceGroups.size()) {
+            runningServiceGroups[service.slot] = 0;
+        }
+        service.pid = 0;
+    }
+
+    // The probe's output is discarded, it usually fails a few times while the service starts. A probe still running
+    // at the deadline, e.g. a curl on a stalled connection, is killed with everything it started and counts as failed
+    static bool probe(const std::string &command, const std::vector<std::string> &env,
+                      std::chrono::steady_clock::time_point deadline) {
+        int devNull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+        SpawnOptions spawn;
+        spawn.stdoutFd = devNull;
+        spawn.stderrFd = devNull;
+        spawn.newProcessGroup = true;
+        spawn.env = env;
+
+        pid_t pid = spawn_shell(command, spawn);
+        if (devNull >= 0) {
+            close(devNull);
+        }
+
+        Service running{"", pid, register_group(pid)};
+        std::optional<int> exitCode;
+        while (!(exitCode = try_wait_exit_code(pid))) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                kill(-pid, SIGKILL);
+                exitCode = wait_exit_code(pid);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        release(running);
+        return *exitCode == 0;
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Counted by the global operator new in main.cpp, only in builds with TASKR_COUNT_ALLOCATIONS
+inline std::atomic<std::size_t> allocationCount{0};
+
+// Startup tracing, enabled with TASKR_TRACE=1. Phases are timed from the end of the previous phase,
+// the report is written to stderr when taskr exits
+class Tracer {
+  public:
+    static Tracer &instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const { return isEnabled; }
+
+    void phase(const std::string &name) {
+        if (!isEnabled)
+            return;
+
+        std::lock_guard lock(mutex);
+        auto now = std::chrono::steady_clock::now();
+        phases.emplace_back(name, std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count());
+        last = now;
+    }
+
+    // Only the first call is recorded, e.g. for the first spawned task
+    void phase_once(const std::string &name) {
+        if (isEnabled && !recordedOnce.exchange(true)) {
+            phase(name);
+        }
+    }
+
+    void counter(const std::string &name, std::size_t value) {
+        if (!isEnabled)
+            return;
+
+        std::lock_guard lock(mutex);
+        counters.emplace_back(name, value);
+    }
+
+    ~Tracer() {
+        if (isEnabled) {
+            report();
+        }
+    }
+
+  private:
+    bool isEnabled;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point last;
+    std::atomic<bool> recordedOnce{false};
+
+    std::mutex mutex;
+    std::vector<std::pair<std::string, long long>> phases;
+    std::vector<std::pair<std::string, std::size_t>> counters;
+
+    Tracer() : start(std::chrono::steady_clock::now()), last(start) {
+        const char *trace = std::getenv("TASKR_TRACE");
+        isEnabled = trace && std::string(trace) == "1";
+    }
+
+    void report() {
+        std::string out = "Taskr trace:\n";
+        for (const auto &[name, ns] : phases) {
+            out += std::format("  {:<24}{:>14} ns\n", name, ns);
+        }
+        out += std::format("  {:<24}{:>14} ns\n", "total",
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(last - start).count());
+
+        for (const auto &[name, value] : counters) {
+            out += std::format("  {:<24}{:>14}\n", name, value);
+        }
+#ifdef TASKR_COUNT_ALLOCATIONS
+        out += std::format("  {:<24}{:>14}\n", "allocations", allocationCount.load());
+#endif
+
+        // Linux only: read and write syscalls issued by taskr itself
+        std::ifstream io("/proc/self/io");
+        std::string key;
+        std::size_t value;
+        while (io >> key >> value) {
+            if (key == "syscr:")
+                out += std::format("  {:<24}{:>14}\n", "read syscalls", value);
+            if (key == "syscw:")
+                out += std::format("  {:<24}{:>14}\n", "write syscalls", value);
+        }
+
+        std::cerr << out << std::flush;
+    }
+};
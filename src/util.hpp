@@ -2,10 +2,19 @@
 
 #include "errors.hpp"
 #include <algorithm>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <limits>
+#include <optional>
 #include <sstream>
+#include <string_view>
 #include <vector>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 namespace fs = std::filesystem;
 
 inline std::string to_lowercase(const std::string &str) {
@@ -74,10 +83,14 @@ inline std::string trim_whitespace(const std::string &str) {
 
 inline std::vector<std::string> split(const std::string &str, char delimiter) {
     std::vector<std::string> tokens;
-    std::string token;
-    std::istringstream tokenStream(str);
-    while (std::getline(tokenStream, token, delimiter)) {
-        tokens.push_back(trim_whitespace(token));
+    std::size_t start = 0;
+    while (start < str.size()) {
+        std::size_t end = str.find(delimiter, start);
+        if (end == std::string::npos) {
+            end = str.size();
+        }
+        tokens.push_back(trim_whitespace(str.substr(start, end - start)));
+        start = end + 1;
     }
     return tokens;
 }
@@ -89,3 +102,214 @@ inline std::string strip_inline_comment(const std::string &line) {
     }
     return line;
 }
+
+inline bool is_number(const std::string &str) {
+    return !str.empty() && std::all_of(str.begin(), str.end(), [](unsigned char c) { return std::isdigit(c); });
+}
+
+// "true" or "false"
+inline std::optional<bool> parse_bool(const std::string &str) {
+    if (str == "true" || str == "false") {
+        return str == "true";
+    }
+    return std::nullopt;
+}
+
+// Integer in [min, max], e.g. a nice level
+inline std::optional<int> parse_int(const std::string &str, int min, int max) {
+    std::string digits = !str.empty() && str[0] == '-' ? str.substr(1) : str;
+    if (!is_number(digits) || digits.size() > 9) {
+        return std::nullopt;
+    }
+
+    int value = std::stoi(str);
+    if (value < min || value > max) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+// CPU list like "0-7" or "0,2,4-6"
+inline std::optional<std::vector<int>> parse_cpu_list(const std::string &str) {
+#ifdef __linux__
+    // The CPUs are handed to sched_setaffinity in a fixed-size cpu_set_t
+    const int maxCpu = CPU_SETSIZE - 1;
+#else
+    const int maxCpu = 4095;
+#endif
+    std::vector<int> cpus;
+
+    for (const std::string &range : split(str, ',')) {
+        std::size_t dash = range.find('-');
+        std::string first = trim_whitespace(range.substr(0, dash));
+        std::string last = dash == std::string::npos ? first : trim_whitespace(range.substr(dash + 1));
+
+        auto from = parse_int(first, 0, maxCpu);
+        auto to = parse_int(last, 0, maxCpu);
+        if (!from || !to || *from > *to) {
+            return std::nullopt;
+        }
+
+        for (int cpu = *from; cpu <= *to; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    if (cpus.empty()) {
+        return std::nullopt;
+    }
+    return cpus;
+}
+
+// CPU bandwidth as "max", a percentage of one CPU ("150%") or cgroup's own "<quota> <period>", in cpu.max format
+inline std::optional<std::string> parse_cpu_max(const std::string &str) {
+    const std::string period = "100000";
+
+    if (str == "max") {
+        return "max " + period;
+    }
+
+    if (str.size() > 1 && str.back() == '%') {
+        std::string percent = str.substr(0, str.size() - 1);
+        if (!is_number(percent) || percent.size() > 6 || std::stoi(percent) == 0) {
+            return std::nullopt;
+        }
+        return std::to_string(std::stoi(percent) * 1000) + " " + period;
+    }
+
+    std::vector<std::string> parts = split(str, ' ');
+    parts.erase(std::remove(parts.begin(), parts.end(), ""), parts.end());
+    if (parts.size() == 2 && (parts[0] == "max" || is_number(parts[0])) && is_number(parts[1])) {
+        return parts[0] + " " + parts[1];
+    }
+    return std::nullopt;
+}
+
+// Memory size as "max" or a byte count with an optional K, M, G or T suffix (powers of 1024), in memory.max format
+inline std::optional<std::string> parse_memory_max(const std::string &str) {
+    if (str == "max") {
+        return str;
+    }
+
+    std::string digits = str;
+    unsigned long long multiplier = 1;
+    if (!digits.empty() && !std::isdigit(static_cast<unsigned char>(digits.back()))) {
+        const std::string units = "KMGT";
+        std::size_t unit = units.find(static_cast<char>(std::toupper(digits.back())));
+        if (unit == std::string::npos) {
+            return std::nullopt;
+        }
+        multiplier = 1ULL << (10 * (unit + 1));
+        digits.pop_back();
+    }
+
+    if (!is_number(digits) || digits.size() > 12) {
+        return std::nullopt;
+    }
+
+    unsigned long long value = std::stoull(digits);
+    if (value > std::numeric_limits<unsigned long long>::max() / multiplier) {
+        return std::nullopt;
+    }
+    return std::to_string(value * multiplier);
+}
+
+inline std::vector<std::string> read_lines(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.good()) {
+        throw FileNotFoundError(path);
+    }
+
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Whole file in one string, for callers that scan it without splitting it into lines first
+inline std::string read_file(const std::string &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.good()) {
+        throw FileNotFoundError(path);
+    }
+
+    std::string content(static_cast<std::size_t>(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(content.data(), static_cast<std::streamsize>(content.size()));
+    return content;
+}
+
+// Case-insensitive subsequence match, nullopt when the query does not match and higher is better otherwise.
+// Matches at the start of a word and consecutive matches score extra, so "bld" ranks "build" above "rebuild_docs"
+inline std::optional<int> fuzzy_score(std::string_view query, std::string_view candidate) {
+    // ASCII only, std::tolower goes through the locale for every character
+    auto lower = [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; };
+
+    if (query.size() > candidate.size()) {
+        return std::nullopt;
+    }
+
+    int score = 0;
+    int streak = 0;
+    std::size_t matched = 0;
+
+    for (std::size_t i = 0; i < candidate.size() && matched < query.size(); ++i) {
+        if (lower(candidate[i]) != lower(query[matched])) {
+            streak = 0;
+            continue;
+        }
+
+        score += 1 + 2 * streak;
+        if (i == 0 || candidate[i - 1] == '_' || candidate[i - 1] == '-' || candidate[i - 1] == ' ') {
+            score += 3;
+        }
+        ++streak;
+        ++matched;
+    }
+
+    if (matched < query.size()) {
+        return std::nullopt;
+    }
+    if (query.size() == candidate.size()) {
+        score += 100;
+    }
+    return score - static_cast<int>((candidate.size() - query.size()) / 8);
+}
+
+// 64-bit FNV-1a, stable across builds and platforms unlike std::hash
+inline std::uint64_t fnv1a_hash(std::string_view data, std::uint64_t hash = 14695981039346656037ULL) {
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Directory where taskr keeps its per-project state (logs, ...)
+inline fs::path taskr_state_dir() { return fs::current_path() / ".taskr"; }
+
+// Reads at most maxBytes from the end of a file, a cut-off first line is dropped.
+// When the tail is one long line (or \r progress output) it is returned as is, so there is always something to show
+inline std::string read_file_tail(const std::string &path, std::size_t maxBytes) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.good()) {
+        return "";
+    }
+
+    std::size_t size = static_cast<std::size_t>(file.tellg());
+    std::size_t start = size > maxBytes ? size - maxBytes : 0;
+
+    std::string tail(size - start, '\0');
+    file.seekg(static_cast<std::streamoff>(start));
+    file.read(tail.data(), static_cast<std::streamsize>(tail.size()));
+
+    if (start > 0) {
+        std::size_t newline = tail.find('\n');
+        if (newline != std::string::npos && newline + 1 < tail.size()) {
+            tail = tail.substr(newline + 1);
+        }
+    }
+    return tail;
+}
@@ -0,0 +1,89 @@
+// Startup perf smoke test: times `taskr <args>` on a generated taskrfile and fails past a threshold.
+// Without args it runs the last task. Usage: taskr_perf_startup <taskr binary> <task count> <max milliseconds> [args]
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: taskr_perf_startup <taskr binary> <task count> <max milliseconds> [args]\n";
+        return 2;
+    }
+
+    const std::string taskr = fs::absolute(argv[1]).string();
+    const int taskCount = std::stoi(argv[2]);
+    const double maxMs = std::stod(argv[3]);
+
+    fs::path dir = fs::temp_directory_path() / ("taskr_perf_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    {
+        std::ofstream file(dir / "taskrfile");
+        file << "default env dev:\n  file = dev.env\n\n";
+        for (int i = 0; i < taskCount; ++i) {
+            file << "task t" << i << ":\n";
+            file << "  run   = true\n";
+            file << "  desc  = generated task " << i << " // with a comment\n";
+            file << "  alias = a" << i << "\n";
+            if (i > 0) {
+                file << "  needs = t0\n";
+            }
+            file << "\n";
+        }
+        std::ofstream env(dir / "dev.env");
+        env << "PERF=1\n";
+    }
+
+    std::vector<std::string> args{"taskr"};
+    args.insert(args.end(), argv + 4, argv + argc);
+    if (args.size() == 1) {
+        args.push_back("t" + std::to_string(taskCount - 1));
+    }
+    std::vector<char *> execArgs;
+    for (auto &arg : args) {
+        execArgs.push_back(arg.data());
+    }
+    execArgs.push_back(nullptr);
+    double bestMs = 0;
+
+    for (int run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (chdir(dir.c_str()) != 0) {
+                _exit(127);
+            }
+            // Output is not part of the timing
+            int devNull = open("/dev/null", O_WRONLY);
+            if (devNull >= 0) {
+                dup2(devNull, STDOUT_FILENO);
+            }
+            execv(taskr.c_str(), execArgs.data());
+            _exit(127);
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::cerr << "taskr exited with status " << status << "\n";
+            fs::remove_all(dir);
+            return 1;
+        }
+        bestMs = run == 0 ? elapsed.count() : std::min(bestMs, elapsed.count());
+    }
+
+    fs::remove_all(dir);
+
+    std::cout << "Startup of '" << args[1] << "' with " << taskCount << " tasks: " << bestMs << " ms (max " << maxMs << " ms)\n";
+    return bestMs <= maxMs ? 0 : 1;
+}
@@ -0,0 +1,73 @@
+#include "cli.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+TEST(CliTest, TaskTest) {
+    CliOptions options = parse_args({"build"});
+    EXPECT_EQ(options.taskNames, std::vector<std::string>{"build"});
+    EXPECT_FALSE(options.list);
+    EXPECT_FALSE(options.quiet);
+    EXPECT_EQ(options.envName, "");
+}
+
+TEST(CliTest, MultipleTasksTest) {
+    CliOptions options = parse_args({"lint", "-e", "prod", "test", "docs"});
+    EXPECT_EQ(options.taskNames, (std::vector<std::string>{"lint", "test", "docs"}));
+    EXPECT_EQ(options.envName, "prod");
+}
+
+TEST(CliTest, EnvironmentTest) {
+    CliOptions options = parse_args({"-e", "prod", "build"});
+    EXPECT_EQ(options.envName, "prod");
+    EXPECT_EQ(options.taskNames, std::vector<std::string>{"build"});
+
+    options = parse_args({"build", "--environment", "prod"});
+    EXPECT_EQ(options.envName, "prod");
+    EXPECT_EQ(options.taskNames, std::vector<std::string>{"build"});
+}
+
+TEST(CliTest, QuietTest) {
+    CliOptions options = parse_args({"-q", "build"});
+    EXPECT_TRUE(options.quiet);
+    EXPECT_EQ(options.taskNames, std::vector<std::string>{"build"});
+}
+
+TEST(CliTest, ResumeTest) {
+    CliOptions options = parse_args({"test", "--resume"});
+    EXPECT_TRUE(options.resume);
+    EXPECT_EQ(options.taskNames, std::vector<std::string>{"test"});
+}
+
+TEST(CliTest, EmitTest) {
+    EXPECT_EQ(parse_args({"--emit", "ninja"}).emit, "ninja");
+    EXPECT_EQ(parse_args({"--emit", "make", "-e", "prod"}).emit, "make");
+    EXPECT_THROW(parse_args({"--emit", "cmake"}), ArgError);
+    EXPECT_THROW(parse_args({"--emit", "ninja", "build"}), ArgError);
+    EXPECT_THROW(parse_args({"--emit", "ninja", "-l"}), ArgError);
+}
+
+TEST(CliTest, QueryTest) {
+    CliOptions options = parse_args({"-l", "bld"});
+    EXPECT_TRUE(options.list);
+    EXPECT_EQ(options.query, "bld");
+    EXPECT_TRUE(options.taskNames.empty());
+
+    options = parse_args({"--complete"});
+    EXPECT_TRUE(options.complete);
+    EXPECT_EQ(options.query, "");
+}
+
+TEST(CliTest, ListAndHelpTest) {
+    EXPECT_TRUE(parse_args({"-l"}).list);
+    EXPECT_TRUE(parse_args({"--help"}).help);
+    EXPECT_TRUE(parse_args({"--check"}).check);
+}
+
+TEST(CliTest, WrongFormatTest) {
+    EXPECT_THROW(parse_args({}), ArgError);
+    EXPECT_THROW(parse_args({"-e"}), ArgError);
+    EXPECT_THROW(parse_args({"-l", "build", "test"}), ArgError);
+    EXPECT_THROW(parse_args({"--check", "build"}), ArgError);
+    EXPECT_THROW(parse_args({"--unknown", "build"}), ArgError);
+}
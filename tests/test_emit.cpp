@@ -0,0 +1,98 @@
+#include "emit.hpp"
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+
+Config emitConfig() {
+    Config config;
+    config.tasks["generate"] = Task{.name = "generate", .run = "cmake -B build"};
+    config.tasks["build"] = Task{.name = "build",
+                                 .run = "echo $HOME",
+                                 .alias = {"b"},
+                                 .needs = {"generate"},
+                                 .inputs = {"main.cpp"},
+                                 .outputs = {"bin/app"}};
+    return config;
+}
+
+TEST(EmitTest, NinjaTest) {
+    Config config = emitConfig();
+    BuildFileEmitter emitter(config, {{"MODE", "it's dev"}});
+
+    EXPECT_EQ(emitter.ninja(), "# Generated by taskr --emit ninja\n\n"
+                               "rule taskr\n"
+                               "  command = $cmd\n"
+                               "  description = $name\n"
+                               "\n"
+                               "build bin/app: taskr main.cpp || generate\n"
+                               "  cmd = env MODE='it'\\''s dev' sh -c 'echo $$HOME'\n"
+                               "  name = build\n"
+                               "build build: phony bin/app\n"
+                               "build b: phony build\n"
+                               "\n"
+                               "build .taskr/stamps/generate: taskr\n"
+                               "  cmd = env MODE='it'\\''s dev' sh -c 'cmake -B build'\n"
+                               "  name = generate\n"
+                               "build generate: phony .taskr/stamps/generate\n");
+}
+
+TEST(EmitTest, MakeTest) {
+    Config config = emitConfig();
+    BuildFileEmitter emitter(config, {});
+
+    EXPECT_EQ(emitter.make(), "# Generated by taskr --emit make\n\n"
+                              ".PHONY: build b generate\n"
+                              "\n"
+                              "build: bin/app\n"
+                              "\n"
+                              "bin/app: main.cpp | generate\n"
+                              "\tsh -c 'echo $$HOME'\n"
+                              "b: build\n"
+                              "\n"
+                              "generate:\n"
+                              "\tsh -c 'cmake -B build'\n");
+}
+
+// Runs the recipe make would run for the task, with make's $$ escaping undone
+int runRecipe(const Config &config, const std::string &taskName) {
+    std::string make = BuildFileEmitter(config, {}).make();
+    std::size_t begin = make.find('\t', make.find("\n" + taskName + ":")) + 1;
+    std::string recipe = make.substr(begin, make.find('\n', begin) - begin);
+
+    std::string command;
+    for (std::size_t i = 0; i < recipe.size(); ++i) {
+        command += recipe[i];
+        if (recipe[i] == '$' && i + 1 < recipe.size() && recipe[i + 1] == '$') {
+            ++i;
+        }
+    }
+
+    int status = std::system((command + " > /dev/null").c_str());
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+TEST(EmitTest, PipeTest) {
+    Config config;
+    config.tasks["dump"] = Task{.name = "dump", .run = "seq 1 100000"};
+    config.tasks["load"] = Task{.name = "load", .run = "head -n 2", .pipe = "dump"};
+    EXPECT_EQ(runRecipe(config, "load"), 0);
+
+    config.tasks["dump"].run = "seq 10; exit 3";
+    config.tasks["load"].run = "cat";
+    EXPECT_EQ(runRecipe(config, "load"), 3);
+
+    config.tasks["dump"].run = "seq 10";
+    config.tasks["load"].run = "cat; exit 4";
+    EXPECT_EQ(runRecipe(config, "load"), 4);
+
+    config.tasks["dump"].run = "yes";
+    config.tasks["load"].run = "head -n 1";
+    EXPECT_EQ(runRecipe(config, "load"), 0);
+}
+
+TEST(EmitTest, ServiceTest) {
+    Config config;
+    config.tasks["db"] = Task{.name = "db", .run = "postgres", .service = true};
+
+    EXPECT_THROW({ BuildFileEmitter emitter(config, {}); }, TaskrError);
+}
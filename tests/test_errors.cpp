@@ -25,3 +25,9 @@ TEST(ErrorTest, ParseErrorTest) {
     ParseError e("unexpected token at line 3");
     EXPECT_STREQ(e.what(), "TaskrError: Parse error: unexpected token at line 3");
 }
+
+TEST(ErrorTest, TaskFailedErrorTest) {
+    TaskFailedError e("build", 2);
+    EXPECT_STREQ(e.what(), "TaskrError: Task 'build' failed with exit code 2");
+    EXPECT_EQ(e.exitCode, 2);
+}
@@ -0,0 +1,181 @@
+#include "executor.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Runs a test in its own temp directory, where the tasks append their names to a runs file
+struct ExecutorDir {
+    fs::path cwd = fs::current_path();
+    fs::path dir = fs::temp_directory_path() / ("taskr_executor_test_" + std::to_string(getpid()));
+
+    ExecutorDir() {
+        fs::create_directories(dir);
+        fs::current_path(dir);
+    }
+
+    ~ExecutorDir() {
+        fs::current_path(cwd);
+        fs::remove_all(dir);
+    }
+
+    // Command that records the task in the runs file
+    std::string record(const std::string &name) const { return "echo " + name + " >> " + (dir / "runs").string(); }
+
+    std::vector<std::string> runs() const {
+        std::ifstream file(dir / "runs");
+        std::vector<std::string> lines;
+        for (std::string line; std::getline(file, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    std::size_t count(const std::string &name) const {
+        auto lines = runs();
+        return std::count(lines.begin(), lines.end(), name);
+    }
+};
+
+TEST(ExecutorTest, SharedDependencyRunsOnceTest) {
+    ExecutorDir dir;
+    Config config;
+    config.tasks["gen"] = Task{.name = "gen", .run = "sleep 0.2; " + dir.record("gen")};
+    config.tasks["lint"] = Task{.name = "lint", .run = dir.record("lint"), .needs = {"gen"}};
+    config.tasks["test"] = Task{.name = "test", .run = dir.record("test"), .needs = {"gen"}};
+
+    TaskrExecutor executor;
+    executor.execute(config, {"lint", "test"});
+
+    // gen is claimed by one target and waited for by the other, which only runs its own task once gen is done
+    std::vector<std::string> runs = dir.runs();
+    ASSERT_EQ(runs.size(), 3);
+    EXPECT_EQ(runs.front(), "gen");
+    EXPECT_EQ(dir.count("lint"), 1);
+    EXPECT_EQ(dir.count("test"), 1);
+}
+
+TEST(ExecutorTest, FirstFailureStopsOtherTargetsTest) {
+    ExecutorDir dir;
+    Config config;
+    config.tasks["broken"] = Task{.name = "broken", .run = "exit 3"};
+    config.tasks["slow"] = Task{.name = "slow", .run = "sleep 0.3; " + dir.record("slow")};
+    config.tasks["deploy"] = Task{.name = "deploy", .run = dir.record("deploy"), .needs = {"slow"}};
+
+    TaskrExecutor executor;
+    try {
+        executor.execute(config, {"broken", "deploy"});
+        FAIL() << "execute should throw";
+    } catch (const TaskFailedError &e) {
+        EXPECT_EQ(e.exitCode, 3);
+    }
+
+    // The step that was already running finishes, the next one is not started
+    EXPECT_EQ(dir.count("slow"), 1);
+    EXPECT_EQ(dir.count("deploy"), 0);
+}
+
+TEST(ExecutorTest, PipeTest) {
+    ExecutorDir dir;
+    Config config;
+    config.tasks["dump"] = Task{.name = "dump", .run = "yes"};
+    config.tasks["load"] = Task{.name = "load", .run = "head -n 1 >> " + (dir.dir / "runs").string(), .pipe = "dump"};
+
+    // yes is killed by SIGPIPE once head exits, which does not fail the pipe
+    TaskrExecutor().execute(config, {"load"});
+    EXPECT_EQ(dir.runs(), (std::vector<std::string>{"y"}));
+
+    config.tasks["dump"].run = "echo y; exit 4";
+    try {
+        TaskrExecutor().execute(config, {"load"});
+        FAIL() << "execute should throw";
+    } catch (const TaskFailedError &e) {
+        EXPECT_STREQ(e.what(), "TaskrError: Task 'dump' failed with exit code 4");
+    }
+}
+
+TEST(ExecutorTest, PipeNeededByAliasTest) {
+    ExecutorDir dir;
+    Config config;
+    config.tasks["dump"] = Task{.name = "dump", .run = "echo y"};
+    config.tasks["up"] =
+        Task{.name = "up", .run = "cat >> " + (dir.dir / "runs").string(), .alias = {"u"}, .pipe = "dump"};
+    config.tasks["all"] = Task{.name = "all", .run = dir.record("all"), .needs = {"up", "u"}};
+
+    TaskrExecutor().execute(config, {"all"});
+    EXPECT_EQ(dir.runs(), (std::vector<std::string>{"y", "all"}));
+}
+
+TEST(ExecutorTest, ReuseLockedResultTest) {
+    ExecutorDir dir;
+    Config config;
+    config.tasks["gen"] = Task{.name = "gen", .run = dir.record("gen")};
+
+    // Another taskr process of the same taskrfile and env runs gen and succeeds while this run waits for it
+    auto holder = std::make_unique<TaskLock>("gen");
+    ASSERT_TRUE(holder->try_acquire());
+    holder->write({.pid = getpid(), .fingerprint = "f"});
+
+    std::thread finisher([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        holder->write({.pid = getpid(), .done = true, .fingerprint = "f"});
+        holder.reset();
+    });
+
+    ExecutorOptions options;
+    options.fingerprint = "f";
+    TaskrExecutor executor(options);
+    executor.execute(config, {"gen"});
+    finisher.join();
+
+    EXPECT_EQ(dir.count("gen"), 0);
+}
+
+TEST(ExecutorTest, LockedResultOfOtherFingerprintTest) {
+    ExecutorDir dir;
+    Config config;
+    config.tasks["gen"] = Task{.name = "gen", .run = dir.record("gen")};
+
+    auto holder = std::make_unique<TaskLock>("gen");
+    ASSERT_TRUE(holder->try_acquire());
+    holder->write({.pid = getpid(), .fingerprint = "prod"});
+
+    std::thread finisher([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        holder->write({.pid = getpid(), .done = true, .fingerprint = "prod"});
+        holder.reset();
+    });
+
+    ExecutorOptions options;
+    options.fingerprint = "dev";
+    TaskrExecutor executor(options);
+    executor.execute(config, {"gen"});
+    finisher.join();
+
+    EXPECT_EQ(dir.count("gen"), 1);
+}
+
+TEST(ExecutorTest, ResumeTest) {
+    ExecutorDir dir;
+    Config config;
+    config.tasks["gen"] = Task{.name = "gen", .run = dir.record("gen")};
+    config.tasks["test"] = Task{.name = "test", .run = "exit 1", .needs = {"gen"}};
+
+    ExecutorOptions options;
+    options.journalName = "test";
+    options.fingerprint = "f";
+    EXPECT_THROW({ TaskrExecutor(options).execute(config, {"test"}); }, TaskFailedError);
+
+    // The resumed run skips gen, which succeeded, and runs test again
+    config.tasks["test"].run = dir.record("test");
+    options.resume = true;
+    TaskrExecutor(options).execute(config, {"test"});
+
+    EXPECT_EQ(dir.runs(), (std::vector<std::string>{"gen", "test"}));
+    EXPECT_FALSE(fs::exists(".taskr/journals/test"));
+}
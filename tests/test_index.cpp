@@ -0,0 +1,63 @@
+#include "index.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+std::vector<std::string> indexLines = {"default env dev:",
+                                       "  file = dev.env // local",
+                                       "env prod:",
+                                       "  file = prod.env",
+                                       "",
+                                       "task generate:",
+                                       "  run = cmake -B build",
+                                       "",
+                                       "task build:",
+                                       "  run   = cmake --build build",
+                                       "  needs = generate",
+                                       "  alias = b, bld",
+                                       "",
+                                       "task docs:",
+                                       "  run = doxygen"};
+
+TEST(IndexTest, BlocksTest) {
+    TaskrIndex index(indexLines);
+
+    ASSERT_EQ(index.get_blocks().size(), 5);
+    EXPECT_EQ(index.get_blocks()[3].name, "build");
+    EXPECT_EQ(index.get_blocks()[3].begin, 8);
+    EXPECT_EQ(index.get_blocks()[3].end, 13);
+    EXPECT_EQ(index.get_blocks()[3].alias, (std::vector<std::string>{"b", "bld"}));
+
+    EXPECT_EQ(index.find_task("bld"), 3);
+    EXPECT_EQ(index.find_task("docs"), 4);
+    EXPECT_EQ(index.find_task("test"), std::nullopt);
+}
+
+TEST(IndexTest, EnvFileTest) {
+    TaskrIndex index(indexLines);
+
+    EXPECT_EQ(index.env_file(""), "dev.env");
+    EXPECT_EQ(index.env_file("prod"), "prod.env");
+    EXPECT_EQ(index.env_file("test"), "");
+}
+
+TEST(IndexTest, ClosureLinesTest) {
+    TaskrIndex index(indexLines);
+
+    std::vector<std::string> closure = index.closure_lines({"b"}, "prod");
+    EXPECT_EQ(closure, (std::vector<std::string>{"env prod:", "  file = prod.env", "", "task generate:",
+                                                 "  run = cmake -B build", "", "task build:",
+                                                 "  run   = cmake --build build", "  needs = generate",
+                                                 "  alias = b, bld", ""}));
+}
+
+TEST(IndexTest, DoubleTaskTest) {
+    std::vector<std::string> lines = {"task build:", "  run = make", "task build:", "  run = make"};
+
+    try {
+        TaskrIndex index(lines);
+        FAIL();
+    } catch (const ParseError &e) {
+        EXPECT_STREQ(e.what(), "TaskrError: Parse error: Task 'build' is defined more than once");
+    }
+}
@@ -0,0 +1,36 @@
+#include "journal.hpp"
+#include <gtest/gtest.h>
+
+TEST(JournalTest, ResumeTest) {
+    const fs::path cwd = fs::current_path();
+    const fs::path dir = fs::temp_directory_path() / "taskr_journal_test";
+    fs::create_directories(dir);
+    fs::current_path(dir);
+
+    {
+        RunJournal journal("test", "abc", false);
+        EXPECT_FALSE(journal.resumable());
+        journal.record("generate");
+        journal.record("build");
+    }
+
+    {
+        RunJournal journal("test", "abc", true);
+        EXPECT_TRUE(journal.resumable());
+        EXPECT_TRUE(journal.has_completed("generate"));
+        EXPECT_TRUE(journal.has_completed("build"));
+        EXPECT_FALSE(journal.has_completed("test"));
+    }
+
+    {
+        RunJournal journal("test", "changed", true);
+        EXPECT_FALSE(journal.resumable());
+        EXPECT_FALSE(journal.has_completed("build"));
+        journal.remove();
+    }
+
+    EXPECT_FALSE(fs::exists(taskr_state_dir() / "journals" / "test"));
+
+    fs::current_path(cwd);
+    fs::remove_all(dir);
+}
@@ -0,0 +1,77 @@
+#include "listing.hpp"
+#include <fstream>
+#include <gtest/gtest.h>
+
+Config listingConfig() {
+    Config config;
+    config.tasks["test"] = Task{.name = "test", .run = "ctest", .desc = "runs tests"};
+    config.tasks["build"] = Task{.name = "build", .run = "make", .desc = "builds executable", .alias = {"b"}};
+    config.tasks["rebuild_docs"] = Task{.name = "rebuild_docs", .run = "doxygen", .desc = "regenerates the docs"};
+    config.environments["dev"] = Environment{.name = "dev", .file = "dev.env", .isDefault = true};
+    return config;
+}
+
+TEST(ListingTest, SortedTest) {
+    EXPECT_EQ(format_config(listingConfig(), ""), "Tasks:\n"
+                                                  "  build           builds executable\n"
+                                                  "  rebuild_docs    regenerates the docs\n"
+                                                  "  test            runs tests\n"
+                                                  "\n"
+                                                  "Environments:\n"
+                                                  "* dev    dev.env\n");
+}
+
+TEST(ListingTest, QueryTest) {
+    EXPECT_EQ(format_config(listingConfig(), "bld"), "Tasks:\n"
+                                                     "  build           builds executable\n"
+                                                     "  rebuild_docs    regenerates the docs\n");
+
+    EXPECT_EQ(format_config(listingConfig(), "executable"), "Tasks:\n"
+                                                            "  build    builds executable\n");
+
+    EXPECT_EQ(format_config(listingConfig(), "xyz"), "No tasks match 'xyz'\n");
+}
+
+TEST(ListingTest, EmptyTest) { EXPECT_EQ(format_config(Config{}, ""), "Config file is empty\n"); }
+
+TEST(ListingTest, CompleteTest) {
+    const std::string content = "default env dev:\n"
+                                "  file = dev.env\n"
+                                "task test:\n"
+                                "  run = ctest\n"
+                                "task build:\n"
+                                "  run   = make\n"
+                                "  alias = b, bld\n";
+
+    EXPECT_EQ(task_names(content), "b\nbld\nbuild\ntest\n");
+    EXPECT_EQ(complete_task_names(task_names(content), ""), "b\nbld\nbuild\ntest\n");
+    EXPECT_EQ(complete_task_names(task_names(content), "bld"), "bld\nbuild\n");
+}
+
+TEST(ListingTest, CompletionCacheTest) {
+    const fs::path cwd = fs::current_path();
+    const fs::path dir = fs::temp_directory_path() / "taskr_completion_test";
+    fs::create_directories(dir);
+    fs::current_path(dir);
+
+    std::ofstream("taskrfile") << "task build:\n  run = make\n";
+    EXPECT_EQ(cached_task_names("taskrfile"), "build\n");
+    EXPECT_FALSE(fs::exists(".taskr"));
+
+    fs::create_directories(".taskr");
+    EXPECT_EQ(cached_task_names("taskrfile"), "build\n");
+    EXPECT_TRUE(fs::exists(".taskr/completion"));
+    EXPECT_EQ(cached_task_names("taskrfile"), "build\n");
+
+    std::ofstream("taskrfile") << "task build:\n  run = make\n  alias = b\n";
+    EXPECT_EQ(cached_task_names("taskrfile"), "b\nbuild\n");
+
+    // A taskrfile in another directory, like the global one, caches in its own .taskr
+    fs::create_directories("global/.taskr");
+    std::ofstream("global/taskrfile") << "task deploy:\n  run = ./deploy\n";
+    EXPECT_EQ(cached_task_names("global/taskrfile"), "deploy\n");
+    EXPECT_TRUE(fs::exists("global/.taskr/completion"));
+
+    fs::current_path(cwd);
+    fs::remove_all(dir);
+}
@@ -0,0 +1,48 @@
+#include "lock.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <unistd.h>
+
+TEST(LockTest, RecordTest) {
+    LockRecord running = parse_lock_record(
+        format_lock_record({.pid = 42, .fingerprint = "0123abcd", .logPath = ".taskr/logs/run/build.log"}));
+    EXPECT_EQ(running.pid, 42);
+    EXPECT_FALSE(running.done);
+    EXPECT_EQ(running.fingerprint, "0123abcd");
+    EXPECT_EQ(running.logPath, ".taskr/logs/run/build.log");
+
+    LockRecord done = parse_lock_record(format_lock_record({.pid = 42, .done = true, .exitCode = 3}));
+    EXPECT_EQ(done.pid, 42);
+    EXPECT_TRUE(done.done);
+    EXPECT_EQ(done.exitCode, 3);
+    EXPECT_EQ(done.fingerprint, "");
+
+    LockRecord spaced = parse_lock_record(format_lock_record({.pid = 42, .logPath = "/tmp/my project/run/a.log"}));
+    EXPECT_EQ(spaced.logPath, "/tmp/my project/run/a.log");
+
+    EXPECT_EQ(parse_lock_record("").pid, 0);
+}
+
+TEST(LockTest, ExclusiveTest) {
+    const fs::path cwd = fs::current_path();
+    const fs::path dir = fs::temp_directory_path() / "taskr_lock_test";
+    fs::create_directories(dir);
+    fs::current_path(dir);
+
+    {
+        TaskLock first("build");
+        TaskLock second("build");
+
+        EXPECT_TRUE(first.try_acquire());
+        EXPECT_FALSE(second.try_acquire());
+
+        first.write({.pid = getpid()});
+        EXPECT_EQ(second.read().pid, getpid());
+    }
+
+    TaskLock third("build");
+    EXPECT_TRUE(third.try_acquire());
+
+    fs::current_path(cwd);
+    fs::remove_all(dir);
+}
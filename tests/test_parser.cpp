@@ -235,3 +235,71 @@ TEST(ParserTest, EnvFileTest) {
                      "TaskrError: Parse error: Invalid line format in environment file: 'imaginary.env': INVALID_LINE");
     }
 }
+
+TEST(ParserTest, PipeTaskTest) {
+    lines = {"task dump:", "  run = echo data", "task load:", "  run = cat", "  pipe = dump"};
+    config = parser.parse_lines(lines);
+
+    EXPECT_EQ(config.tasks.at("load").pipe, "dump");
+    EXPECT_EQ(config.tasks.at("dump").pipe, "");
+}
+
+TEST(ParserTest, UnresolvedPipeTaskTest) {
+    lines = {"task load:", "  run = cat", "  pipe = dump"};
+
+    EXPECT_THROW({ parser.parse_lines(lines); }, ParseError);
+
+    try {
+        parser.parse_lines(lines);
+    } catch (const ParseError &e) {
+        EXPECT_STREQ(e.what(), "TaskrError: Parse error: Pipe source 'dump' could not be resolved");
+    }
+}
+
+TEST(ParserTest, ResourceKeysTaskTest) {
+    lines = {"task build:",  "  run = make", "  nice = 10", "  cpuset = 0-1", "  cpu_max = 50%",
+             "  memory_max = 1G"};
+    config = parser.parse_lines(lines);
+
+    const Task &task = config.tasks.at("build");
+    EXPECT_EQ(task.nice, 10);
+    EXPECT_EQ(task.cpuset, (std::vector<int>{0, 1}));
+    EXPECT_EQ(task.cpuMax, "50000 100000");
+    EXPECT_EQ(task.memoryMax, "1073741824");
+}
+
+TEST(ParserTest, InvalidResourceKeyTaskTest) {
+    lines = {"task build:", "  run = make", "  nice = 42"};
+
+    EXPECT_THROW({ parser.parse_lines(lines); }, ParseError);
+
+    try {
+        parser.parse_lines(lines);
+    } catch (const ParseError &e) {
+        EXPECT_STREQ(e.what(), "TaskrError: Parse error: Task 'build' has an invalid value for 'nice': 42");
+    }
+}
+
+TEST(ParserTest, ServiceTaskTest) {
+    lines = {"task db:", "  run = postgres", "  service = true", "  ready = pg_isready", "  endpoint = localhost:5432",
+             "  ready_timeout = 60"};
+    config = parser.parse_lines(lines);
+
+    const Task &task = config.tasks.at("db");
+    EXPECT_TRUE(task.service);
+    EXPECT_EQ(task.ready, "pg_isready");
+    EXPECT_EQ(task.endpoint, "localhost:5432");
+    EXPECT_EQ(task.readyTimeout, 60);
+}
+
+TEST(ParserTest, ReadyWithoutServiceTaskTest) {
+    lines = {"task db:", "  run = postgres", "  ready = pg_isready"};
+
+    EXPECT_THROW({ parser.parse_lines(lines); }, ParseError);
+
+    try {
+        parser.parse_lines(lines);
+    } catch (const ParseError &e) {
+        EXPECT_STREQ(e.what(), "TaskrError: Parse error: Task 'db' sets 'ready' or 'endpoint' but is not a service");
+    }
+}
@@ -0,0 +1,76 @@
+#include "service.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+TEST(ServiceTest, EnvNameTest) {
+    EXPECT_EQ(ServiceManager::env_name("db"), "TASKR_SERVICE_DB");
+    EXPECT_EQ(ServiceManager::env_name("type-check_2"), "TASKR_SERVICE_TYPE_CHECK_2");
+}
+
+TEST(ServiceTest, StartStopTest) {
+    ServiceManager services;
+    Task task{.name = "worker", .run = "exec sleep 30", .service = true, .ready = "true", .endpoint = "localhost:9000"};
+
+    services.start(task, {});
+    EXPECT_EQ(services.environment(), (std::vector<std::string>{"TASKR_SERVICE_WORKER=localhost:9000"}));
+
+    EXPECT_EQ(services.stop_all(), (std::vector<std::string>{"worker"}));
+    EXPECT_TRUE(services.environment().empty());
+    EXPECT_TRUE(services.stop_all().empty());
+}
+
+TEST(ServiceTest, ExitBeforeReadyTest) {
+    ServiceManager services;
+    Task task{.name = "worker", .run = "exit 3", .service = true, .ready = "false"};
+
+    try {
+        services.start(task, {});
+        FAIL() << "start should throw";
+    } catch (const TaskrError &e) {
+        EXPECT_STREQ(e.what(), "TaskrError: Service 'worker' exited with code 3 before it was ready");
+    }
+    EXPECT_TRUE(services.stop_all().empty());
+}
+
+TEST(ServiceTest, ReadyTimeoutTest) {
+    ServiceManager services;
+    Task task{.name = "worker", .run = "exec sleep 30", .service = true, .ready = "false", .readyTimeout = 1};
+
+    EXPECT_THROW({ services.start(task, {}); }, TaskrError);
+    EXPECT_EQ(services.stop_all(), (std::vector<std::string>{"worker"}));
+}
+
+TEST(ServiceTest, HangingProbeTest) {
+    ServiceManager services;
+    Task task{.name = "worker", .run = "exec sleep 30", .service = true, .ready = "sleep 30", .readyTimeout = 1};
+
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_THROW({ services.start(task, {}); }, TaskrError);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    EXPECT_EQ(services.stop_all(), (std::vector<std::string>{"worker"}));
+}
+
+TEST(ServiceTest, EndpointReplacesInheritedTest) {
+    const std::string path = (std::filesystem::temp_directory_path() / "taskr_service_env_test").string();
+    setenv("TASKR_SERVICE_WORKER", "outer:1", 1);
+
+    ServiceManager services;
+    services.start({.name = "worker", .run = "exec sleep 30", .service = true, .endpoint = "inner:2"}, {});
+
+    SpawnOptions spawn;
+    spawn.env = services.environment();
+    EXPECT_EQ(wait_exit_code(spawn_shell("env | grep '^TASKR_SERVICE_WORKER=' > " + path, spawn)), 0);
+
+    std::ifstream file(path);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(contents, "TASKR_SERVICE_WORKER=inner:2\n");
+
+    services.stop_all();
+    unsetenv("TASKR_SERVICE_WORKER");
+    std::filesystem::remove(path);
+}
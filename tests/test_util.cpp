@@ -30,3 +30,95 @@ TEST(UtilTest, StripInlineComment){
     original = "Hello World! / this is not a comment";
     EXPECT_EQ(strip_inline_comment(original), original);
 }
+
+TEST(UtilTest, ReadFileTail){
+    const std::string path = (fs::temp_directory_path() / "taskr_tail_test.log").string();
+    {
+        std::ofstream file(path);
+        file << "first line\nsecond line\nthird line\n";
+    }
+
+    EXPECT_EQ(read_file_tail(path, 1024), "first line\nsecond line\nthird line\n");
+    EXPECT_EQ(read_file_tail(path, 16), "third line\n");
+    EXPECT_EQ(read_file_tail(path + ".missing", 16), "");
+
+    {
+        std::ofstream file(path);
+        file << "10%\r50%\r100%\r";
+    }
+    EXPECT_EQ(read_file_tail(path, 8), "0%\r100%\r");
+    {
+        std::ofstream file(path);
+        file << "short\na very long last line\n";
+    }
+    EXPECT_EQ(read_file_tail(path, 10), "last line\n");
+
+    fs::remove(path);
+}
+
+TEST(UtilTest, ParseBool){
+    EXPECT_EQ(parse_bool("true"), true);
+    EXPECT_EQ(parse_bool("false"), false);
+    EXPECT_EQ(parse_bool("yes"), std::nullopt);
+}
+
+TEST(UtilTest, ParseInt){
+    EXPECT_EQ(parse_int("10", -20, 19), 10);
+    EXPECT_EQ(parse_int("-5", -20, 19), -5);
+    EXPECT_EQ(parse_int("20", -20, 19), std::nullopt);
+    EXPECT_EQ(parse_int("ten", -20, 19), std::nullopt);
+}
+
+TEST(UtilTest, ParseCpuList){
+    EXPECT_EQ(parse_cpu_list("0-3"), (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_EQ(parse_cpu_list("0, 2, 4-5"), (std::vector<int>{0, 2, 4, 5}));
+    EXPECT_EQ(parse_cpu_list("3-1"), std::nullopt);
+    EXPECT_EQ(parse_cpu_list("a-b"), std::nullopt);
+    EXPECT_EQ(parse_cpu_list("1023"), (std::vector<int>{1023}));
+    EXPECT_EQ(parse_cpu_list("2000"), std::nullopt);
+}
+
+TEST(UtilTest, ParseCpuMax){
+    EXPECT_EQ(parse_cpu_max("max"), "max 100000");
+    EXPECT_EQ(parse_cpu_max("150%"), "150000 100000");
+    EXPECT_EQ(parse_cpu_max("50000 100000"), "50000 100000");
+    EXPECT_EQ(parse_cpu_max("fast"), std::nullopt);
+}
+
+TEST(UtilTest, ParseMemoryMax){
+    EXPECT_EQ(parse_memory_max("max"), "max");
+    EXPECT_EQ(parse_memory_max("4096"), "4096");
+    EXPECT_EQ(parse_memory_max("512M"), "536870912");
+    EXPECT_EQ(parse_memory_max("2g"), "2147483648");
+    EXPECT_EQ(parse_memory_max("12X"), std::nullopt);
+    EXPECT_EQ(parse_memory_max("16777215T"), "18446742974197923840");
+    EXPECT_EQ(parse_memory_max("999999999999T"), std::nullopt);
+}
+
+TEST(UtilTest, ReadLines){
+    const std::string path = (fs::temp_directory_path() / "taskr_read_lines_test").string();
+    {
+        std::ofstream file(path);
+        file << "task build:\n  run = make\n";
+    }
+
+    EXPECT_EQ(read_lines(path), (std::vector<std::string>{"task build:", "  run = make"}));
+    EXPECT_THROW(read_lines(path + ".missing"), FileNotFoundError);
+
+    fs::remove(path);
+}
+
+TEST(UtilTest, Fnv1aHash){
+    EXPECT_EQ(fnv1a_hash(""), 14695981039346656037ULL);
+    EXPECT_EQ(fnv1a_hash("a"), 0xaf63dc4c8601ec8cULL);
+    EXPECT_NE(fnv1a_hash("taskrfile"), fnv1a_hash("taskrfilf"));
+}
+
+TEST(UtilTest, FuzzyScore){
+    EXPECT_EQ(fuzzy_score("bld", "docs"), std::nullopt);
+    EXPECT_EQ(fuzzy_score("", "docs"), 0);
+    EXPECT_GT(fuzzy_score("bld", "build"), fuzzy_score("bld", "rebuild_docs"));
+    EXPECT_GT(fuzzy_score("gen", "generate"), fuzzy_score("gen", "big_engine"));
+    EXPECT_GT(fuzzy_score("test", "test"), fuzzy_score("test", "test_all"));
+    EXPECT_TRUE(fuzzy_score("BLD", "build").has_value());
+}